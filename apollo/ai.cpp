@@ -6,116 +6,321 @@
 
 #include "ai.h"
 #include "debug_draw.h"
+#include "flow_field.h"
 #include "game.h"
 #include "game_object.h"
+#include "lifecycle_events.h"
 #include "physics.h"
 #include "profiler.h"
 #include "tweakables.h"
 #include "world.h"
+#include "world_chunks.h"
 
 using namespace std;
+using namespace std::chrono;
 
-std::vector<AIModelAlienRandom> randomAIs;
-std::vector<AIModelAlienShy> shyAIs;
-std::vector<AIModelAlienChase> chaseAIs;
-std::vector<AIModelAlienMothership> mothershipAIs;
-std::vector<AIModelAlienOffspring> offspringAIs;
-std::vector<AIModelAlienWallHugger> wallHuggerAIs;
+
+void DestroyAI(World& world, ObjectId objectId)
+{
+	// pending timed actions and behaviours of the dead alien are dropped when they next come due
+	DispatchGameObjectType(AIGameObjectTypes {}, GetType(objectId), [&world, objectId] <GameObjectType Type> () {
+		GetAIModels<typename GameObjectTraits<Type>::AIModel>(world.ai).Remove(objectId);
+	});
+}
 
 
-void CreateAI(ObjectId objectId)
+void OnAILifecycleEvent(World& world, const LifecycleEvent& lifecycleEvent)
 {
-	switch (GetType(objectId))
+	if (lifecycleEvent.type != LifecycleEventType::Killed)
+		return;
+
+	// the mothership counts its live offspring rather than checking on each of them
+	if (GetType(lifecycleEvent.objectId) == GameObjectType::AlienOffspring)
 	{
-	case GameObjectType::Player:
-		break;
-	case GameObjectType::Bullet:
-		break;
-	case GameObjectType::AlienRandom:
-		randomAIs.emplace_back(objectId);
-		break;
-	case GameObjectType::AlienChase:
-		chaseAIs.emplace_back(objectId);
-		break;
-	case GameObjectType::AlienShy:
-		shyAIs.emplace_back(objectId);
-		break;
-	case GameObjectType::AlienMothership:
-		mothershipAIs.emplace_back(objectId);
-		break;
-	case GameObjectType::AlienOffspring:
-		offspringAIs.emplace_back(objectId);
-		break;
-	case GameObjectType::AlienWallHugger:
-		wallHuggerAIs.emplace_back(objectId);
-		break;
+		auto* offspring = GetAIModels<AIModelAlienOffspring>(world.ai).Find(lifecycleEvent.objectId);
+		auto* mothership = offspring ? GetAIModels<AIModelAlienMothership>(world.ai).Find(offspring->parentId) : nullptr;
+		if (mothership)
+			--mothership->liveOffspringCount;
+	}
+
+	DestroyAI(world, lifecycleEvent.objectId);
+}
+
+
+void InitAI(World& world)
+{
+	SubscribeToLifecycleEvents(world, OnAILifecycleEvent);
+}
+
+
+TWEAKABLE(int, aiUpdateBudgetMicroseconds, "AI.UpdateBudgetMicroseconds", 0, 0, 20000); // 0 disables the budget, a wall clock budget is for profiling as the updates it defers depend on the timing
+TWEAKABLE(float, aiLevelOfDetailNearDistance, "AI.LevelOfDetail.NearDistance", 300.0f, 0.0f, 2000.0f);
+TWEAKABLE(float, aiLevelOfDetailFarDistance, "AI.LevelOfDetail.FarDistance", 600.0f, 0.0f, 2000.0f);
+
+namespace
+{
+	struct AISchedulerFrame
+	{
+		World& world;
+		Time time;
+		Vector2 playerPosition;
+		high_resolution_clock::time_point startTime;
+		bool budgetExhausted { false };
 	};
+
+	// the largest number of frames between updates that the per-frame models tolerate
+	const uint32_t maxAIUpdateInterval = 4;
+
+	// how long the timed actions of aliens outside of the active chunks wait before trying again
+	const float inactiveTimedActionDelay = 1.0f;
+
+	uint32_t GetAIUpdateInterval(float distanceToPlayer)
+	{
+		if (distanceToPlayer > aiLevelOfDetailFarDistance)
+			return maxAIUpdateInterval;
+		else if (distanceToPlayer > aiLevelOfDetailNearDistance)
+			return 2;
+		return 1;
+	}
+
+	bool IsAIUpdateBudgetExhausted(AISchedulerFrame& frame)
+	{
+		if (aiUpdateBudgetMicroseconds <= 0)
+			return false;
+		if (!frame.budgetExhausted)
+		{
+			auto elapsed = duration_cast<microseconds>(high_resolution_clock::now() - frame.startTime);
+			frame.budgetExhausted = elapsed.count() >= aiUpdateBudgetMicroseconds;
+		}
+		return frame.budgetExhausted;
+	}
 }
 
 
+const AISchedulerStatistics& GetAISchedulerStatistics(const World& world)
+{
+	return world.ai.schedulerStatistics;
+}
+
+
+// models that schedule work on the timer wheel
+template <typename AIModel>
+concept TimedAIModel = requires (AIModel& aiModel, World& world, AITimedAction action, const Time& time) { aiModel.OnTimedAction(world, action, time); };
+
+// models that are updated every frame, subject to their level of detail and the budget
+template <typename AIModel>
+concept PerFrameAIModel = requires (AIModel& aiModel, World& world, const Time& time) { aiModel.Update(world, time); };
+
 template <typename AIType>
-void UpdateAIType(vector<AIType>& aiModels, const Time& time)
+bool ExecuteTimedAction(World& world, AIModelArray<AIType>& aiModels, const TimedAction& timedAction, const Time& time)
+{
+	// dead aliens no longer have a model, so drop their actions rather than rescheduling them
+	auto* aiModel = aiModels.Find(timedAction.objectId);
+	if (!aiModel)
+		return false;
+	// aliens outside of the active chunks are frozen, so their actions wait until they are back in the simulation
+	if (!IsObjectInActiveWorldChunk(world, timedAction.objectId))
+	{
+		world.ai.timerWheel.Schedule(timedAction.objectId, timedAction.action, time.elapsedTime + inactiveTimedActionDelay);
+		return false;
+	}
+	aiModel->OnTimedAction(world, static_cast<AITimedAction>(timedAction.action), time);
+	return true;
+}
+
+void ExecuteTimedActions(World& world, const Time& time)
 {
 	PROFILER_TIMER_FUNCTION();
 
-	for (auto& aiModel : aiModels)
+	thread_local vector<TimedAction> dueActions;
+	dueActions.clear();
+	world.ai.timerWheel.Advance(time.elapsedTime, dueActions);
+
+	for (const auto& timedAction : dueActions)
 	{
-		if (GetGameObject(aiModel.objectId).isAlive)
-			aiModel.Update(time);
+		bool executed = false;
+		DispatchGameObjectType(AIGameObjectTypes {}, GetType(timedAction.objectId), [&world, &timedAction, &time, &executed] <GameObjectType Type> () {
+			using AIModel = typename GameObjectTraits<Type>::AIModel;
+			if constexpr (TimedAIModel<AIModel>)
+				executed = ExecuteTimedAction(world, GetAIModels<AIModel>(world.ai), timedAction, time);
+			else
+				assert(false);
+		});
+		if (executed)
+			++world.ai.schedulerStatistics.timedActionsExecuted;
 	}
 }
 
 
-void UpdateAI(const Time& time)
+// the per-frame models of the aliens in the active chunks, gathered at the start of each update
+template <typename AIModel>
+vector<AIModel*>& GetActiveAIModels(AIState& ai)
+{
+	return get<vector<AIModel*>>(ai.activeModels);
+}
+
+void GatherActiveAIModels(World& world)
 {
 	PROFILER_TIMER_FUNCTION();
 
-	UpdateAIType<AIModelAlienRandom>(randomAIs, time);
-	UpdateAIType<AIModelAlienShy>(shyAIs, time);
-	UpdateAIType<AIModelAlienChase>(chaseAIs, time);
-	UpdateAIType<AIModelAlienMothership>(mothershipAIs, time);
-	UpdateAIType<AIModelAlienOffspring>(offspringAIs, time);
-	UpdateAIType<AIModelAlienWallHugger>(wallHuggerAIs, time);
+	ForEachGameObjectType(AIGameObjectTypes {}, [&world] <GameObjectType Type> () {
+		using AIModel = typename GameObjectTraits<Type>::AIModel;
+		if constexpr (PerFrameAIModel<AIModel>)
+			GetActiveAIModels<AIModel>(world.ai).clear();
+	});
+
+	for (const auto objectId : world.chunks.activeObjectIds)
+	{
+		DispatchGameObjectType(AIGameObjectTypes {}, GetType(objectId), [&world, objectId] <GameObjectType Type> () {
+			using AIModel = typename GameObjectTraits<Type>::AIModel;
+			if constexpr (PerFrameAIModel<AIModel>)
+			{
+				// the models of aliens killed this frame have already been removed
+				if (auto* aiModel = GetAIModels<AIModel>(world.ai).Find(objectId))
+				{
+					GetActiveAIModels<AIModel>(world.ai).push_back(aiModel);
+					++world.ai.schedulerStatistics.active;
+				}
+			}
+		});
+	}
 }
 
 
+template <typename AIType>
+void UpdateAIType(const vector<AIType*>& aiModels, AISchedulerFrame& frame)
+{
+	PROFILER_TIMER_FUNCTION();
+
+	// every model belongs to a live alien in an active chunk, and no models are added or removed during the update
+	// rotate the starting model every frame so that the budget doesn't always starve the same models
+	World& world = frame.world;
+	const uint32_t aiFrameIndex = world.ai.frameIndex;
+	auto& aiSchedulerStatistics = world.ai.schedulerStatistics;
+	const size_t modelCount = aiModels.size();
+	for (size_t i = 0; i < modelCount; ++i)
+	{
+		auto& aiModel = *aiModels[(aiFrameIndex + i) % modelCount];
+		auto& schedule = aiModel.schedule;
+		const float distanceToPlayer = glm::distance(GetRigidBody(world, aiModel.objectId).position, frame.playerPosition);
+		const uint32_t interval = GetAIUpdateInterval(distanceToPlayer);
+		const uint32_t framesSinceLastUpdate = aiFrameIndex - schedule.frameOfLastUpdate;
+		const bool neverUpdated = schedule.timeOfLastUpdate < 0.0f;
+
+		// spread each population across the frames of its update interval, catching up on anything that was deferred
+		const bool isDue = neverUpdated || ((aiFrameIndex + GetIndex(aiModel.objectId)) % interval == 0) || (framesSinceLastUpdate > interval);
+		if (!isDue)
+		{
+			++aiSchedulerStatistics.skippedByLevelOfDetail;
+			continue;
+		}
+
+		// once the budget has been spent only models that are overdue are still updated
+		const bool isOverdue = neverUpdated || (framesSinceLastUpdate >= 2 * maxAIUpdateInterval);
+		if (!isOverdue && IsAIUpdateBudgetExhausted(frame))
+		{
+			++aiSchedulerStatistics.deferredByBudget;
+			continue;
+		}
+
+		// models that skipped frames integrate over the time since they were last updated
+		Time modelTime = frame.time;
+		if (!neverUpdated)
+			modelTime.deltaTime = min(frame.time.elapsedTime - schedule.timeOfLastUpdate, 0.1f);
+		aiModel.Update(world, modelTime);
+
+		schedule.frameOfLastUpdate = aiFrameIndex;
+		schedule.timeOfLastUpdate = frame.time.elapsedTime;
+		++aiSchedulerStatistics.updated;
+	}
+}
+
 
-void UpdateRandomVelocity(ObjectId objectId, RigidBody& rigidBody, const Time& /*time*/, float lookAheadTime)
+using UpdateAITypeFunction = void (*)(AISchedulerFrame&);
+
+template <GameObjectType... Types>
+vector<UpdateAITypeFunction> MakeUpdateAITypeFunctions(GameObjectTypeList<Types...>)
+{
+	vector<UpdateAITypeFunction> updateAITypeFunctions;
+	ForEachGameObjectType(GameObjectTypeList<Types...> {}, [&updateAITypeFunctions] <GameObjectType Type> () {
+		using AIModel = typename GameObjectTraits<Type>::AIModel;
+		if constexpr (PerFrameAIModel<AIModel>)
+			updateAITypeFunctions.push_back([] (AISchedulerFrame& frame) { UpdateAIType(GetActiveAIModels<AIModel>(frame.world.ai), frame); });
+	});
+	return updateAITypeFunctions;
+}
+
+// one function for each type whose models are updated every frame
+const vector<UpdateAITypeFunction>& GetUpdateAITypeFunctions()
+{
+	static const vector<UpdateAITypeFunction> updateAITypeFunctions = MakeUpdateAITypeFunctions(AIGameObjectTypes {});
+	return updateAITypeFunctions;
+}
+
+
+void UpdateAI(World& world, const Time& time)
 {
-	auto& collisionObject = GetCollisionObject(objectId);
+	PROFILER_TIMER_FUNCTION();
+
+	AISchedulerFrame frame { world, time, GetRigidBody(world, world.player.objectId).position, high_resolution_clock::now() };
+
+	auto& ai = world.ai;
+	ai.schedulerStatistics = AISchedulerStatistics {};
+	ai.schedulerStatistics.budgetMicroseconds = aiUpdateBudgetMicroseconds;
+
+	BuildFlowField(world);
+
+	ExecuteTimedActions(world, time);
+
+	ai.schedulerStatistics.behavioursResumed = ai.coroutineScheduler.Update(world, time);
+
+	// after the behaviours, which may launch new aliens
+	GatherActiveAIModels(world);
+
+	// rotate the order of the types as well, so that the types at the end of the list aren't always the ones deferred
+	const auto& updateAITypeFunctions = GetUpdateAITypeFunctions();
+	const size_t typeCount = updateAITypeFunctions.size();
+	for (size_t i = 0; i < typeCount; ++i)
+	{
+		updateAITypeFunctions[(ai.frameIndex + i) % typeCount](frame);
+	}
+
+	ai.schedulerStatistics.timedActionsPending = static_cast<int>(ai.timerWheel.GetPendingCount());
+	ai.schedulerStatistics.behavioursRunning = static_cast<int>(ai.coroutineScheduler.GetBehaviourCount());
+	ai.schedulerStatistics.elapsedMicroseconds = static_cast<int>(duration_cast<microseconds>(high_resolution_clock::now() - frame.startTime).count());
+	++ai.frameIndex;
+}
+
+
+
+void UpdateRandomVelocity(World& world, ObjectId objectId, RigidBody& rigidBody, const Time& /*time*/, float lookAheadTime)
+{
+	auto& collisionObject = GetCollisionObject(world, objectId);
 	bool validMoveTarget = false;
 	const float maxAlienSpeed = 40.0f;
 	do
 	{
-		Vector2 newDirection = GetRandomVectorOnCircle();
+		Vector2 newDirection = GetRandomVectorOnCircle(world.random);
 		rigidBody.velocity = maxAlienSpeed * newDirection;
 		Vector2 futurePosition = rigidBody.position + rigidBody.velocity * lookAheadTime;
-		validMoveTarget = !BoundingBoxCollidesWithWorldEdge(futurePosition, newDirection, collisionObject.boundingBoxDimensions);
+		validMoveTarget = !BoundingBoxCollidesWithWorldEdge(world, futurePosition, newDirection, collisionObject.boundingBoxDimensions);
 	} while (!validMoveTarget);
 }
 
 
-void UpdateChaseVelocity(ObjectId objectId, RigidBody& rigidBody, const Time& time)
+void UpdateChaseVelocity(World& world, ObjectId objectId, RigidBody& rigidBody, const Time& time)
 {
 	Vector2 forces { 0.0f, 0.0f };
 
+	auto neighborhood = SampleFlowField(world, objectId, rigidBody);
+
 	// the chase enemy is attracted by the player
 	const float playerAttraction = 1000.0f;
-	const auto& playerRigidBody = GetRigidBody(player.objectId);
-	Vector2 playerPosition = playerRigidBody.position;
-	forces += playerAttraction * glm::normalize(playerPosition - rigidBody.position);
+	forces += playerAttraction * neighborhood.playerDirection;
 
 	// the chase enemy is repelled by other nearby enemies
-	auto nearbyAliens = GetAliensInCircle(rigidBody.position, 50.0f);
-	for (ObjectId nearbyAlienId : nearbyAliens)
-	{
-		if (nearbyAlienId == objectId)
-			continue;
-
-		const auto& nearbyAlienRB = GetRigidBody(nearbyAlienId);
-		const float alienRepulsion = 1000.0f;
-		forces += alienRepulsion * glm::normalize(rigidBody.position - nearbyAlienRB.position);
-	}
+	const float alienRepulsion = 1000.0f;
+	forces += alienRepulsion * neighborhood.alienRepulsion;
 
 	const float maxAlienSpeed = 40.0f;
 	const float velocityDampening = 0.5f;
@@ -129,148 +334,155 @@ void UpdateChaseVelocity(ObjectId objectId, RigidBody& rigidBody, const Time& ti
 }
 
 
-AIModelAlienRandom::AIModelAlienRandom(ObjectId objectId)
+const float maxTimeBetweenMovementChanges = 1.0f;
+const float timeBetweenShots = 1.2f;
+
+AIModelAlienRandom::AIModelAlienRandom(World& world, ObjectId objectId)
 	: objectId(objectId)
 {
-	auto& rigidBody = GetRigidBody(objectId);
-	rigidBody.angularVelocity = 20.0f * (GetRandomFloat01() - 0.5f);
+	auto& rigidBody = GetRigidBody(world, objectId);
+	rigidBody.angularVelocity = 20.0f * (GetRandomFloat01(world.random) - 0.5f);
+
+	world.ai.timerWheel.Schedule(objectId, static_cast<uint32_t>(AITimedAction::ChangeDirection), maxTimeBetweenMovementChanges);
+	world.ai.timerWheel.Schedule(objectId, static_cast<uint32_t>(AITimedAction::Fire), timeBetweenShots);
 }
 
-void AIModelAlienRandom::Update(const Time& time)
+void AIModelAlienRandom::OnTimedAction(World& world, AITimedAction action, const Time& time)
 {
 	PROFILER_TIMER_FUNCTION();
 
-	auto& rigidBody = GetRigidBody(objectId);
+	auto& rigidBody = GetRigidBody(world, objectId);
 
-	const float maxTimeBetweenMovementChanges = 1.0f;
-	if (time.elapsedTime - timeOfLastMovementChange > maxTimeBetweenMovementChanges)
+	if (action == AITimedAction::ChangeDirection)
 	{
-		UpdateRandomVelocity(objectId, rigidBody, time, maxTimeBetweenMovementChanges);
-		timeOfLastMovementChange = time.elapsedTime;
+		UpdateRandomVelocity(world, objectId, rigidBody, time, maxTimeBetweenMovementChanges);
+		world.ai.timerWheel.Schedule(objectId, static_cast<uint32_t>(AITimedAction::ChangeDirection), time.elapsedTime + maxTimeBetweenMovementChanges);
 	}
-
-	if (time.elapsedTime - timeOfLastShot > 1.2f)
+	else if (action == AITimedAction::Fire)
 	{
-		const auto& playerRigidBody = GetRigidBody(player.objectId);
+		const auto& playerRigidBody = GetRigidBody(world, world.player.objectId);
 		Vector2 directionTowardsPlayer = glm::normalize(playerRigidBody.position - rigidBody.position);
 		Vector2 bulletPosition = rigidBody.position + 8.0f * directionTowardsPlayer;
 		const float bulletSpeed = 100.0f;
 		Vector2 bulletVelocity = directionTowardsPlayer * bulletSpeed;
-		CreateBullet(bulletPosition, bulletVelocity, CollisionLayer::Alien, CollisionLayer::Player);
-		timeOfLastShot = time.elapsedTime;
+		CreateBullet(world, bulletPosition, bulletVelocity, CollisionLayer::Alien, CollisionLayer::Player);
+		world.ai.timerWheel.Schedule(objectId, static_cast<uint32_t>(AITimedAction::Fire), time.elapsedTime + timeBetweenShots);
 	}
 }
 
-AIModelAlienShy::AIModelAlienShy(ObjectId objectId)
+AIModelAlienShy::AIModelAlienShy(World& world, ObjectId objectId)
 	: objectId(objectId)
 {
-	auto& rigidBody = GetRigidBody(objectId);
-	rigidBody.angularVelocity = 20.0f * (GetRandomFloat01() - 0.5f);
+	auto& rigidBody = GetRigidBody(world, objectId);
+	rigidBody.angularVelocity = 20.0f * (GetRandomFloat01(world.random) - 0.5f);
+
+	world.ai.timerWheel.Schedule(objectId, static_cast<uint32_t>(AITimedAction::ChangeDirection), maxTimeBetweenMovementChanges);
 }
 
-void AIModelAlienShy::Update(const Time& time)
+void AIModelAlienShy::OnTimedAction(World& world, AITimedAction action, const Time& time)
 {
 	PROFILER_TIMER_FUNCTION();
 
-	auto& rigidBody = GetRigidBody(objectId);
-	const float maxTimeBetweenMovementChanges = 1.0f;
-	if (time.elapsedTime - timeOfLastMovementChange > maxTimeBetweenMovementChanges)
-	{
-		const auto& playerRigidBody = GetRigidBody(player.objectId);
-		Vector2 playerFacing = playerRigidBody.facing;
-		Vector2 playerPosition = playerRigidBody.position;
+	assert(action == AITimedAction::ChangeDirection);
+	auto& rigidBody = GetRigidBody(world, objectId);
+	const auto& playerRigidBody = GetRigidBody(world, world.player.objectId);
+	Vector2 playerFacing = playerRigidBody.facing;
+	Vector2 playerPosition = playerRigidBody.position;
 
-		// check if the player is facing towards this enemy
-		if (glm::dot(playerFacing, rigidBody.position - playerPosition) > 0)
-		{
-			// if they are then choose a random direction to move in
-			UpdateRandomVelocity(objectId, rigidBody, time, maxTimeBetweenMovementChanges);
-			timeOfLastMovementChange = time.elapsedTime;
-		}
-		else
-		{
-			UpdateChaseVelocity(objectId, rigidBody, time);
-		}
-		timeOfLastMovementChange = time.elapsedTime;
+	// check if the player is facing towards this enemy
+	if (glm::dot(playerFacing, rigidBody.position - playerPosition) > 0)
+	{
+		// if they are then choose a random direction to move in
+		UpdateRandomVelocity(world, objectId, rigidBody, time, maxTimeBetweenMovementChanges);
 	}
+	else
+	{
+		UpdateChaseVelocity(world, objectId, rigidBody, time);
+	}
+	world.ai.timerWheel.Schedule(objectId, static_cast<uint32_t>(action), time.elapsedTime + maxTimeBetweenMovementChanges);
 }
 
 
-AIModelAlienChase::AIModelAlienChase(ObjectId objectId)
+AIModelAlienChase::AIModelAlienChase(World& world, ObjectId objectId)
 	: objectId(objectId)
 {
-	auto& rigidBody = GetRigidBody(objectId);
-	rigidBody.angularVelocity = 20.0f * (GetRandomFloat01() - 0.5f);
+	auto& rigidBody = GetRigidBody(world, objectId);
+	rigidBody.angularVelocity = 20.0f * (GetRandomFloat01(world.random) - 0.5f);
 }
 
-void AIModelAlienChase::Update(const Time& time)
+void AIModelAlienChase::Update(World& world, const Time& time)
 {
 	PROFILER_TIMER_FUNCTION();
 
-	auto& rigidBody = GetRigidBody(objectId);
-	UpdateChaseVelocity(objectId, rigidBody, time);
+	auto& rigidBody = GetRigidBody(world, objectId);
+	UpdateChaseVelocity(world, objectId, rigidBody, time);
 }
 
 
-AIModelAlienMothership::AIModelAlienMothership(ObjectId objectId)
+const int numberOfLaunchesPerWave = 20;
+
+AIBehaviour RunMothershipBehaviour(World& world, ObjectId objectId);
+
+AIModelAlienMothership::AIModelAlienMothership(World& world, ObjectId objectId)
 	: objectId(objectId)
 {
-	auto& rigidBody = GetRigidBody(objectId);
-	rigidBody.angularVelocity = (GetRandomFloat01() < 0.5f ? -1.0f : 1.0f) * 2.0f;
-	offspring.reserve(20);
+	auto& rigidBody = GetRigidBody(world, objectId);
+	rigidBody.angularVelocity = (GetRandomFloat01(world.random) < 0.5f ? -1.0f : 1.0f) * 2.0f;
+
+	world.ai.coroutineScheduler.Start(objectId, RunMothershipBehaviour(world, objectId));
 }
 
-void AIModelAlienMothership::Update(const Time& /*time*/)
+bool IsMothershipReadyToLaunch(const World& world, ObjectId objectId)
 {
-	PROFILER_TIMER_FUNCTION();
-
-	const int numberOfLaunchesPerWave = 20;
+	const auto& mothership = *GetAIModels<AIModelAlienMothership>(world.ai).Find(objectId);
+	const bool needsToLaunch = (mothership.currentMode == AIModelAlienMothership::LaunchingMode::Launching) ||
+		(mothership.liveOffspringCount < 0.5f * numberOfLaunchesPerWave);
+	return needsToLaunch && IsObjectInActiveWorldChunk(world, objectId);
+}
 
-	if (currentMode == LaunchingMode::Waiting)
+AIBehaviour RunMothershipBehaviour(World& world, ObjectId objectId)
+{
+	// the model is looked up again after every suspension as the model array may have changed in the meantime
+	for (;;)
 	{
-		// remove all dead offspring from the list
-		auto isDead = [] (ObjectId offspringObjectId) {
-			return !GetGameObject(offspringObjectId).isAlive;
-		};
-		offspring.erase(remove_if(begin(offspring), end(offspring), isDead), end(offspring));
-
-		if (offspring.size() < 0.5f * numberOfLaunchesPerWave)
-			currentMode = LaunchingMode::Launching;
-	}
+		// wait for most of the previous wave to die off
+		co_await AIWaitUntil { world, objectId, IsMothershipReadyToLaunch };
 
-	if (currentMode == LaunchingMode::Launching)
-	{
-		offspring.push_back(LaunchOffspring());
-		if (offspring.size() >= numberOfLaunchesPerWave)
+		auto* mothership = GetAIModels<AIModelAlienMothership>(world.ai).Find(objectId);
+		if (mothership->currentMode == AIModelAlienMothership::LaunchingMode::Waiting)
 		{
-			currentMode = LaunchingMode::Waiting;
+			mothership->currentMode = AIModelAlienMothership::LaunchingMode::Launching;
+			mothership->launchesRemaining = numberOfLaunchesPerWave;
 		}
+
+		// launch the wave, one offspring per frame
+		while (mothership->launchesRemaining > 0)
+		{
+			mothership->LaunchOffspring(world);
+			--mothership->launchesRemaining;
+			co_await AINextFrame {};
+			mothership = GetAIModels<AIModelAlienMothership>(world.ai).Find(objectId);
+		}
+		mothership->currentMode = AIModelAlienMothership::LaunchingMode::Waiting;
 	}
-	// launch offspring
 }
 
-ObjectId AIModelAlienMothership::LaunchOffspring()
+ObjectId AIModelAlienMothership::LaunchOffspring(World& world)
 {
-	aliens.push_back(GameObject::CreateGameObject<GameObjectType::AlienOffspring>());
-	GameObject& child = aliens.back();
-
-	const auto& parentRB = GetRigidBody(objectId);
-	Vector2 childHeading = GetRandomVectorOnCircle();
+	const auto& parentRB = GetRigidBody(world, objectId);
+	Vector2 childHeading = GetRandomVectorOnCircle(world.random);
 	Vector2 childPosition = parentRB.position + 16.0f * childHeading;
 	Vector2 childFacing = childHeading;
 
-	AddRigidBody(child.objectId, childPosition, childFacing);
-	auto& collisionObject = AddCollisionObject(child.objectId, Vector2 { 16.0f, 16.0f });
-	collisionObject.layer = CollisionLayer::Alien;
-	collisionObject.layerMask = CollisionLayer::Player | CollisionLayer::PlayerBullet;
+	ObjectId childObjectId = SpawnAlien<GameObjectType::AlienOffspring>(world, childPosition, childFacing).objectId;
+	GetAIModels<AIModelAlienOffspring>(world.ai).Find(childObjectId)->parentId = objectId;
+	++liveOffspringCount;
 
-	CreateAI(child.objectId);
-
-	return child.objectId;
+	return childObjectId;
 }
 
 
-AIModelAlienOffspring::AIModelAlienOffspring(ObjectId objectId)
+AIModelAlienOffspring::AIModelAlienOffspring(World& /*world*/, ObjectId objectId)
 	: objectId(objectId)
 {
 }
@@ -278,75 +490,41 @@ AIModelAlienOffspring::AIModelAlienOffspring(ObjectId objectId)
 TWEAKABLE(float, cohesionMagnitude, "Alien.Offspring.CohesionMagnitude", 1000.0f, 0.0f, 1000.0f);
 TWEAKABLE(float, cohesionRadius, "Alien.Offspring.CohesionRadius", 50.0f, 0.0f, 1000.0f);
 TWEAKABLE(float, alignmentMagnitude, "Alien.Offspring.AlignmentMagnitude", 10.0f, 0.0f, 1000.0f);
-TWEAKABLE(float, alignmentRadius, "Alien.Offspring.AlignmentRadius", 50.0f, 0.0f, 1000.0f);
 TWEAKABLE(float, separationMagnitude, "Alien.Offspring.SeparationMagnitude", 500.0f, 0.0f, 1000.0f);
-TWEAKABLE(float, separationRadius, "Alien.Offspring.SeparationRadius", 30.0f, 0.0f, 1000.0f);
 
-void AIModelAlienOffspring::Update(const Time& time)
+void AIModelAlienOffspring::Update(World& world, const Time& time)
 {
 	PROFILER_TIMER_FUNCTION();
 
-	auto& rigidBody = GetRigidBody(objectId);
-
-	// flocking parameters
+	auto& rigidBody = GetRigidBody(world, objectId);
 
-	Vector2 totalCohesionForce { 0.0f, 0.0f };
-	Vector2 totalAlignmentForce { 0.0f, 0.0f };
-	Vector2 totalSeparationForce { 0.0f, 0.0f };
-	float numberOfOffspringNeighbors { 0.0f };
-	float numberOfAllNeighbors { 0.0f };
+	// flocking forces from the neighbouring flow field cells
+	auto neighborhood = SampleFlowField(world, objectId, rigidBody);
 
-	auto nearbyAliens = GetAliensInCircle(rigidBody.position, 50.0f);
-	for (ObjectId nearbyAlienId : nearbyAliens)
+	Vector2 forces { 0.0f, 0.0f };
+	if (neighborhood.offspringCount > 0.0f)
 	{
-		if (nearbyAlienId == objectId)
-			continue;
-
-		++numberOfAllNeighbors;
-
-		const auto& nearbyAlienRB = GetRigidBody(nearbyAlienId);
-		float nearbyAlienDistance = glm::distance(nearbyAlienRB.position, rigidBody.position);
-		if (GetType(nearbyAlienId) == GetType(objectId))
+		float cohesionDistance = glm::distance(neighborhood.offspringCentroid, rigidBody.position);
+		if ((cohesionDistance < cohesionRadius) && (cohesionDistance > 0.0f))
 		{
-			++numberOfOffspringNeighbors;
-
-			// add flocking forces
-			if ((nearbyAlienDistance < cohesionRadius) && (nearbyAlienDistance > 0.0f))
-			{
-				totalCohesionForce = cohesionMagnitude * (nearbyAlienDistance / cohesionRadius) * glm::normalize(nearbyAlienRB.position - rigidBody.position);
-			}
-			if ((nearbyAlienDistance < alignmentRadius) && (glm::length(nearbyAlienRB.velocity) > 0.0f))
-			{
-				Vector2 alignmentForce = alignmentMagnitude * /*(1.0f - nearbyAlienDistance / alignmentRadius) * */glm::normalize(nearbyAlienRB.velocity);
-				totalAlignmentForce += alignmentForce;
-			}
+			Vector2 totalCohesionForce = cohesionMagnitude * (cohesionDistance / cohesionRadius) * glm::normalize(neighborhood.offspringCentroid - rigidBody.position);
+			//DebugDrawLine(rigidBody.position, rigidBody.position + totalCohesionForce * 0.1f, Color::Green);
+			forces += totalCohesionForce / neighborhood.offspringCount;
 		}
-
-		if ((nearbyAlienDistance < separationRadius) && (nearbyAlienDistance > 0.0f))
-		{
-			Vector2 separationForce = separationMagnitude * (1.0f - nearbyAlienDistance / separationRadius) * glm::normalize(rigidBody.position - nearbyAlienRB.position);
-			totalSeparationForce += separationForce;
-		}
-	}
-
-	Vector2 forces { 0.0f, 0.0f };
-	if (numberOfOffspringNeighbors > 0.0f)
-	{
-		totalCohesionForce = totalCohesionForce / numberOfOffspringNeighbors;
-		//DebugDrawLine(rigidBody.position, rigidBody.position + totalCohesionForce * 0.1f, Color::Green);
-		forces += totalCohesionForce;
-		totalAlignmentForce = totalAlignmentForce / numberOfOffspringNeighbors;
+		Vector2 totalAlignmentForce = alignmentMagnitude * neighborhood.offspringHeading;
 		//DebugDrawLine(rigidBody.position, rigidBody.position + totalAlignmentForce * 1.0f, Color::Yellow);
 		forces += totalAlignmentForce;
 	}
-	if (numberOfAllNeighbors > 0.0f)
+	if (neighborhood.alienCount > 0.0f)
 	{
-		totalSeparationForce = totalSeparationForce / numberOfAllNeighbors;
+		Vector2 totalSeparationForce = separationMagnitude * neighborhood.alienRepulsion / neighborhood.alienCount;
 		//DebugDrawLine(rigidBody.position, rigidBody.position + totalSeparationForce * 1.0f, Color::Orange);
 		forces += totalSeparationForce;
 	}
 	
 	// repulsion for world edges
+	const Vector2& minWorld = world.minWorld;
+	const Vector2& maxWorld = world.maxWorld;
 	const float wallRepulsionRadius = 100.0f;
 	const float wallRepulsionMagnitude = 300.0f;
 	if (rigidBody.position.x - minWorld.x < wallRepulsionRadius)
@@ -380,13 +558,12 @@ void AIModelAlienOffspring::Update(const Time& time)
 
 	// additional force attracting the flock to the player
 	const float playerAttraction = 500.0f;
-	const auto& playerRigidBody = GetRigidBody(player.objectId);
-	float playerDistance = glm::distance(playerRigidBody.position, rigidBody.position);
+	float playerDistance = glm::distance(world.flowField.playerPosition, rigidBody.position);
 	if (playerDistance > 0.0f)
 	{
 		float worldSize = glm::distance(minWorld, maxWorld);
 		float distanceFactor = (playerDistance / worldSize) * (playerDistance / worldSize);
-		Vector2 playerAttractionForce = playerAttraction * distanceFactor * glm::normalize(playerRigidBody.position - rigidBody.position);
+		Vector2 playerAttractionForce = playerAttraction * distanceFactor * neighborhood.playerDirection;
 		//DebugDrawLine(rigidBody.position, rigidBody.position + playerAttractionForce * 1.0f, Color::White);
 		forces += playerAttractionForce;
 	}
@@ -407,71 +584,108 @@ void AIModelAlienOffspring::Update(const Time& time)
 }
 
 
-AIModelAlienWallHugger::AIModelAlienWallHugger(ObjectId objectId)
+AIBehaviour RunWallHuggerBehaviour(World& world, ObjectId objectId);
+
+AIModelAlienWallHugger::AIModelAlienWallHugger(World& world, ObjectId objectId)
 	: objectId(objectId)
 {
+	world.ai.coroutineScheduler.Start(objectId, RunWallHuggerBehaviour(world, objectId));
 }
 
 TWEAKABLE(float, wallHuggerSpeed, "Alien.WallHugger.Speed", 150.0f, 0.0f, 1000.0f);
 TWEAKABLE(float, wallHuggerCrossingProbability, "Alien.WallHugger.CrossingProbability", 0.002f, 0.0f, 0.01f);
 
-void AIModelAlienWallHugger::Update(const Time& /*time*/)
+void SlideAlongWall(World& world, AIModelAlienWallHugger& wallHugger)
 {
-	PROFILER_TIMER_FUNCTION();
+	auto& rigidBody = GetRigidBody(world, wallHugger.objectId);
+	const auto& collisionObject = GetCollisionObject(world, wallHugger.objectId);
 
-	auto& rigidBody = GetRigidBody(objectId);
-	Vector2 position = rigidBody.position;
-	Vector2 facing = rigidBody.facing;
-	const auto& collisionObject = GetCollisionObject(objectId);
+	Vector2 position;
+	Vector2 facing;
+	float wallCoord = GetPositionAlongWallCoordFromPositionAndFacing(world, rigidBody.position, rigidBody.facing);
+	tie(position, facing) = GetPositionAndFacingFromWallCoord(world, wallCoord, collisionObject.boundingBoxDimensions);
 
-	if (currentMovementMode == MovementMode::Stationary)
-	{
-		currentMovementMode = (GetRandomFloat01() < 0.5f) ? MovementMode::SlideLeft : MovementMode::SlideRight;
-	}
+	if (wallHugger.currentMovementMode == AIModelAlienWallHugger::MovementMode::SlideLeft)
+		rigidBody.velocity = wallHuggerSpeed * Vector2 { -facing.y, facing.x };
+	else // if (wallHugger.currentMovementMode == AIModelAlienWallHugger::MovementMode::SlideRight)
+		rigidBody.velocity = wallHuggerSpeed * Vector2 { facing.y, -facing.x };
 
-	if (currentMovementMode != MovementMode::Crossing)
+	if (GetRandomFloat01(world.random) < wallHuggerCrossingProbability)
 	{
-		float wallCoord = GetPositionAlongWallCoordFromPositionAndFacing(position, facing);
-		tie(position, facing) = GetPositionAndFacingFromWallCoord(wallCoord, collisionObject.boundingBoxDimensions);
-
-		if (currentMovementMode == MovementMode::SlideLeft)
-			rigidBody.velocity = wallHuggerSpeed * Vector2 { -facing.y, facing.x };
-		else // if (currentMovementMode == MovementMode::SlideRight)
-			rigidBody.velocity = wallHuggerSpeed * Vector2 { facing.y, -facing.x };
+		wallHugger.currentMovementMode = AIModelAlienWallHugger::MovementMode::Crossing;
+		wallHugger.wallStartPosition = rigidBody.position;
+		rigidBody.velocity = wallHuggerSpeed * facing;
+	}
 
+	rigidBody.position = position;
+	rigidBody.facing = facing;
+}
 
-		if (GetRandomFloat01() < wallHuggerCrossingProbability)
-		{
-			currentMovementMode = MovementMode::Crossing;
-			wallStartPosition = rigidBody.position;
-			rigidBody.velocity = wallHuggerSpeed * facing;
-		}
-	}
+bool HasCrossedArena(const World& world, ObjectId objectId)
+{
+	const Vector2& minWorld = world.minWorld;
+	const Vector2& maxWorld = world.maxWorld;
+	const auto& rigidBody = GetRigidBody(world, objectId);
+	const Vector2 position = rigidBody.position;
+	const Vector2 facing = rigidBody.facing;
+	return ((facing.x < 0) && (position.x < minWorld.x)) ||
+		((facing.x > 0) && (position.x > maxWorld.x)) ||
+		((facing.y < 0) && (position.y < minWorld.y)) ||
+		((facing.y > 0) && (position.y > maxWorld.y));
+}
 
-	if (currentMovementMode == MovementMode::Crossing)
-	{
-		if (((facing.x < 0) && (position.x < minWorld.x)) ||
-			((facing.x > 0) && (position.x > maxWorld.x)) ||
-			((facing.y < 0) && (position.y < minWorld.y)) ||
-			((facing.y > 0) && (position.y > maxWorld.y)))
-		{
-			// when we hit the other side, reverse the facing so that GetPositionAlongWallCoordFromPositionAndFacing works
-			facing = -facing;
-			float wallCoord = GetPositionAlongWallCoordFromPositionAndFacing(position, facing);
-			tie(position, facing) = GetPositionAndFacingFromWallCoord(wallCoord, collisionObject.boundingBoxDimensions);
+void FinishCrossing(World& world, AIModelAlienWallHugger& wallHugger)
+{
+	auto& rigidBody = GetRigidBody(world, wallHugger.objectId);
+	const auto& collisionObject = GetCollisionObject(world, wallHugger.objectId);
 
-			Vector2 wallFinishPosition = position;
-			CreateWall(wallStartPosition, wallFinishPosition);
+	// when we hit the other side, reverse the facing so that GetPositionAlongWallCoordFromPositionAndFacing works
+	Vector2 position;
+	Vector2 facing;
+	float wallCoord = GetPositionAlongWallCoordFromPositionAndFacing(world, rigidBody.position, -rigidBody.facing);
+	tie(position, facing) = GetPositionAndFacingFromWallCoord(world, wallCoord, collisionObject.boundingBoxDimensions);
 
-			currentMovementMode = MovementMode::Stationary;
-			rigidBody.velocity = Vector2 { 0.0f, 0.0f };
-		}
-	}
+	CreateWall(world, wallHugger.wallStartPosition, position);
 
+	wallHugger.currentMovementMode = AIModelAlienWallHugger::MovementMode::Stationary;
 	rigidBody.position = position;
 	rigidBody.facing = facing;
+	rigidBody.velocity = Vector2 { 0.0f, 0.0f };
 }
 
+AIBehaviour RunWallHuggerBehaviour(World& world, ObjectId objectId)
+{
+	for (;;)
+	{
+		auto* wallHugger = GetAIModels<AIModelAlienWallHugger>(world.ai).Find(objectId);
+		if (wallHugger->currentMovementMode == AIModelAlienWallHugger::MovementMode::Stationary)
+			wallHugger->currentMovementMode = (GetRandomFloat01(world.random) < 0.5f) ? AIModelAlienWallHugger::MovementMode::SlideLeft : AIModelAlienWallHugger::MovementMode::SlideRight;
+
+		// slide along the wall every frame until we decide to cross the arena
+		while (wallHugger->currentMovementMode != AIModelAlienWallHugger::MovementMode::Crossing)
+		{
+			// outside of the active chunks the wall hugger is frozen along with everything else
+			co_await AIWaitUntil { world, objectId, IsObjectInActiveWorldChunk };
+			wallHugger = GetAIModels<AIModelAlienWallHugger>(world.ai).Find(objectId);
+			SlideAlongWall(world, *wallHugger);
+			co_await AINextFrame {};
+			wallHugger = GetAIModels<AIModelAlienWallHugger>(world.ai).Find(objectId);
+		}
 
+		// physics carries us across, there is nothing to do until we reach the other side
+		co_await AIWaitUntil { world, objectId, HasCrossedArena };
+		FinishCrossing(world, *GetAIModels<AIModelAlienWallHugger>(world.ai).Find(objectId));
+		co_await AINextFrame {};
+	}
+}
 
 
+void RestartAIBehaviours(World& world, float elapsedTime)
+{
+	auto& scheduler = world.ai.coroutineScheduler;
+	scheduler.Clear(elapsedTime);
+	for (const auto& mothership : GetAIModels<AIModelAlienMothership>(world.ai).models)
+		scheduler.Start(mothership.objectId, RunMothershipBehaviour(world, mothership.objectId));
+	for (const auto& wallHugger : GetAIModels<AIModelAlienWallHugger>(world.ai).models)
+		scheduler.Start(wallHugger.objectId, RunWallHuggerBehaviour(world, wallHugger.objectId));
+}
@@ -1,78 +1,115 @@
 #pragma once
 
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 #include "game.h"
+#include "game_object.h"
+#include "ai_coroutine.h"
 #include "math_helpers.h"
+#include "timer_wheel.h"
 
 struct Time;
 struct GameObject;
+struct World;
 
 
 
-void CreateAI(ObjectId objectId);
+// subscribes the AI to the lifecycle events, models are destroyed when their alien is killed
+void InitAI(World& world);
 
-void UpdateAI(const Time& time);
+void UpdateAI(World& world, const Time& time);
 
 
+// Distant aliens are updated less often (their level of detail) and each type's population is spread across frames.
+// UpdateAI also stops issuing optional updates once the per-frame budget has been spent.
+struct AIUpdateSchedule
+{
+	uint32_t frameOfLastUpdate { 0 };
+	float timeOfLastUpdate { -1.0f }; // negative until the model is first updated
+};
+
+struct AISchedulerStatistics
+{
+	int active { 0 }; // per-frame models in the active world chunks
+	int updated { 0 };
+	int skippedByLevelOfDetail { 0 };
+	int deferredByBudget { 0 };
+	int timedActionsExecuted { 0 };
+	int timedActionsPending { 0 };
+	int behavioursResumed { 0 };
+	int behavioursRunning { 0 };
+	int budgetMicroseconds { 0 };
+	int elapsedMicroseconds { 0 };
+};
+
+
+// Actions that AI models schedule on the timer wheel rather than polling for every frame.
+enum class AITimedAction : uint32_t { ChangeDirection, Fire };
+
+// coroutine frames can't be snapshotted, so after a replay the behaviours are restarted from the state in their models
+void RestartAIBehaviours(World& world, float elapsedTime);
+
+const AISchedulerStatistics& GetAISchedulerStatistics(const World& world);
 
 
 struct AIModelAlienRandom
 {
-	explicit AIModelAlienRandom(ObjectId objectId);
-	void Update(const Time& time);
+	AIModelAlienRandom(World& world, ObjectId objectId);
+	void OnTimedAction(World& world, AITimedAction action, const Time& time);
 
 	ObjectId objectId;
-	float timeOfLastMovementChange { 0.0f };
-	float timeOfLastShot { 0.0f };
 };
 
 
 struct AIModelAlienShy
 {
-	explicit AIModelAlienShy(ObjectId objectId);
-	void Update(const Time& time);
+	AIModelAlienShy(World& world, ObjectId objectId);
+	void OnTimedAction(World& world, AITimedAction action, const Time& time);
 
 	ObjectId objectId;
-	float timeOfLastMovementChange { 0.0f };
 };
 
 
 struct AIModelAlienChase
 {
-	explicit AIModelAlienChase(ObjectId objectId);
-	void Update(const Time& time);
+	AIModelAlienChase(World& world, ObjectId objectId);
+	void Update(World& world, const Time& time);
 
 	ObjectId objectId;
+	AIUpdateSchedule schedule;
 };
 
 
 struct AIModelAlienMothership
 {
-	explicit AIModelAlienMothership(ObjectId objectId);
-	void Update(const Time& time);
-	ObjectId LaunchOffspring();
+	AIModelAlienMothership(World& world, ObjectId objectId);
+	ObjectId LaunchOffspring(World& world);
 
 	ObjectId objectId;
 	enum class LaunchingMode { Waiting, Launching };
 	LaunchingMode currentMode { LaunchingMode::Waiting };
-	std::vector<ObjectId> offspring;
+	int launchesRemaining { 0 };
+	int liveOffspringCount { 0 }; // decremented by the lifecycle events as the offspring are killed
 };
 
 
 struct AIModelAlienOffspring
 {
-	explicit AIModelAlienOffspring(ObjectId objectId);
-	void Update(const Time& time);
+	AIModelAlienOffspring(World& world, ObjectId objectId);
+	void Update(World& world, const Time& time);
 
 	ObjectId objectId;
+	ObjectId parentId { 0 };
+	AIUpdateSchedule schedule;
 };
 
 
 struct AIModelAlienWallHugger
 {
-	explicit AIModelAlienWallHugger(ObjectId objectId);
-	void Update(const Time& time);
+	AIModelAlienWallHugger(World& world, ObjectId objectId);
 
 	ObjectId objectId;
 	enum class MovementMode { Stationary, SlideLeft, SlideRight, Crossing };
@@ -81,9 +118,88 @@ struct AIModelAlienWallHugger
 };
 
 
-extern std::vector<AIModelAlienRandom> randomAIs;
-extern std::vector<AIModelAlienShy> shyAIs;
-extern std::vector<AIModelAlienChase> chaseAIs;
-extern std::vector<AIModelAlienMothership> mothershipAIs;
-extern std::vector<AIModelAlienOffspring> offspringAIs;
-extern std::vector<AIModelAlienWallHugger> wallHuggerAIs;
+// The models of one AI type. Only live aliens have a model, the model of an alien is swap-removed when it is killed,
+// so the cost of updating the AI follows the number of live aliens rather than the number ever spawned.
+// Swap-removal reorders the models, so the position of each model is kept in an index.
+template <typename AIModel>
+struct AIModelArray
+{
+	AIModel& Add(World& world, ObjectId objectId)
+	{
+		indices[objectId] = static_cast<uint32_t>(models.size());
+		models.emplace_back(world, objectId);
+		return models.back();
+	}
+
+	void Remove(ObjectId objectId)
+	{
+		auto indexIter = indices.find(objectId);
+		if (indexIter == indices.end())
+			return;
+		uint32_t index = indexIter->second;
+		indices.erase(indexIter);
+		if (index + 1 < models.size())
+		{
+			models[index] = std::move(models.back());
+			indices[models[index].objectId] = index;
+		}
+		models.pop_back();
+	}
+
+	AIModel* Find(ObjectId objectId)
+	{
+		auto indexIter = indices.find(objectId);
+		return (indexIter != indices.end()) ? &models[indexIter->second] : nullptr;
+	}
+
+	const AIModel* Find(ObjectId objectId) const
+	{
+		auto indexIter = indices.find(objectId);
+		return (indexIter != indices.end()) ? &models[indexIter->second] : nullptr;
+	}
+
+	std::vector<AIModel> models;
+	std::unordered_map<ObjectId, uint32_t> indices;
+};
+
+template <typename List>
+struct AIModelArraysOf;
+
+template <GameObjectType... Types>
+struct AIModelArraysOf<GameObjectTypeList<Types...>>
+{
+	using Type = std::tuple<AIModelArray<typename GameObjectTraits<Types>::AIModel>...>;
+	using ActiveType = std::tuple<std::vector<typename GameObjectTraits<Types>::AIModel*>...>;
+};
+
+// one model array for every type that has an AI model in its traits
+using AIModelArrays = typename AIModelArraysOf<AIGameObjectTypes>::Type;
+
+// the models of the aliens in the active chunks, gathered at the start of each update
+using ActiveAIModels = typename AIModelArraysOf<AIGameObjectTypes>::ActiveType;
+
+
+// The AI of one world.
+struct AIState
+{
+	AICoroutineFramePool framePool; // declared before the scheduler so that it outlives the frames of the behaviours
+	AIModelArrays modelArrays;
+	ActiveAIModels activeModels;
+	TimerWheel timerWheel;
+	// multi-step behaviours (the mothership's launch waves, the wall hugger's slide and cross) run as coroutines
+	AICoroutineScheduler coroutineScheduler;
+	uint32_t frameIndex { 0 };
+	AISchedulerStatistics schedulerStatistics;
+};
+
+template <typename AIModel>
+AIModelArray<AIModel>& GetAIModels(AIState& ai)
+{
+	return std::get<AIModelArray<AIModel>>(ai.modelArrays);
+}
+
+template <typename AIModel>
+const AIModelArray<AIModel>& GetAIModels(const AIState& ai)
+{
+	return std::get<AIModelArray<AIModel>>(ai.modelArrays);
+}
@@ -0,0 +1,217 @@
+#include "ai_coroutine.h"
+
+#include <algorithm>
+#include <cassert>
+#include <new>
+
+#include "profiler.h"
+#include "world.h"
+#include "world_chunks.h"
+
+using namespace std;
+
+
+void* AICoroutineFramePool::Allocate(size_t size)
+{
+	++m_blocksInUse;
+	if (size > BlockSize)
+	{
+		++m_oversizedAllocations;
+		return ::operator new(size);
+	}
+
+	if (!m_freeList)
+	{
+		m_chunks.push_back(make_unique<uint8_t[]>(BlockSize * BlocksPerChunk));
+		uint8_t* chunk = m_chunks.back().get();
+		for (size_t i = 0; i < BlocksPerChunk; ++i)
+		{
+			auto* block = reinterpret_cast<FreeBlock*>(chunk + i * BlockSize);
+			block->next = m_freeList;
+			m_freeList = block;
+		}
+	}
+
+	FreeBlock* block = m_freeList;
+	m_freeList = block->next;
+	return block;
+}
+
+void AICoroutineFramePool::Free(void* block, size_t size)
+{
+	assert(m_blocksInUse > 0);
+	--m_blocksInUse;
+	if (size > BlockSize)
+	{
+		::operator delete(block);
+		return;
+	}
+
+	auto* freeBlock = static_cast<FreeBlock*>(block);
+	freeBlock->next = m_freeList;
+	m_freeList = freeBlock;
+}
+
+
+namespace
+{
+	// each frame is preceded by a pointer to the pool that it was allocated from, padded to keep the frame aligned
+	const size_t frameHeaderSize = alignof(max_align_t);
+	static_assert(sizeof(AICoroutineFramePool*) <= frameHeaderSize, "the frame header must hold a pool pointer");
+
+	// how long a behaviour waiting on a condition outside of the active chunks waits before its condition is checked again
+	const float inactiveConditionDelay = 1.0f;
+}
+
+void* AIBehaviour::promise_type::operator new(size_t size, World& world, ObjectId /*objectId*/)
+{
+	auto& pool = world.ai.framePool;
+	auto* block = static_cast<uint8_t*>(pool.Allocate(frameHeaderSize + size));
+	*reinterpret_cast<AICoroutineFramePool**>(block) = &pool;
+	return block + frameHeaderSize;
+}
+
+void AIBehaviour::promise_type::operator delete(void* frame, size_t size)
+{
+	auto* block = static_cast<uint8_t*>(frame) - frameHeaderSize;
+	auto* pool = *reinterpret_cast<AICoroutineFramePool**>(block);
+	pool->Free(block, frameHeaderSize + size);
+}
+
+
+
+AICoroutineScheduler::~AICoroutineScheduler()
+{
+	for (auto& behaviour : m_behaviours)
+	{
+		if (behaviour.handle)
+			behaviour.handle.destroy();
+	}
+}
+
+
+void AICoroutineScheduler::Start(ObjectId objectId, AIBehaviour&& behaviour)
+{
+	auto handle = behaviour.Release();
+	assert(handle);
+	uint32_t behaviourIndex = 0;
+	if (m_freeBehaviours.empty())
+	{
+		behaviourIndex = static_cast<uint32_t>(m_behaviours.size());
+		m_behaviours.emplace_back();
+	}
+	else
+	{
+		behaviourIndex = m_freeBehaviours.back();
+		m_freeBehaviours.pop_back();
+	}
+	m_behaviours[behaviourIndex] = Behaviour { objectId, handle };
+	m_nextFrame.push_back(behaviourIndex);
+}
+
+
+int AICoroutineScheduler::Update(World& world, const Time& time)
+{
+	PROFILER_TIMER_FUNCTION();
+
+	m_resuming.clear();
+	swap(m_resuming, m_nextFrame);
+
+	// behaviours waiting on a delay cost nothing until the timer wheel says they are due
+	m_dueDelays.clear();
+	m_delays.Advance(time.elapsedTime, m_dueDelays);
+	for (const auto& dueDelay : m_dueDelays)
+	{
+		// a condition that was parked outside of the active chunks is checked again rather than resumed
+		if (m_behaviours[dueDelay.action].handle.promise().wait.type == AIWait::Type::Condition)
+			m_waitingForCondition.push_back(dueDelay.action);
+		else
+			m_resuming.push_back(dueDelay.action);
+	}
+
+	// behaviours waiting on a condition poll it once per update while they are in the active chunks, outside of them
+	// the world is frozen so they are parked on the timer wheel and only checked again every so often
+	auto conditionMet = [this, &world, &time] (uint32_t behaviourIndex) {
+		const auto& behaviour = m_behaviours[behaviourIndex];
+		if (!GetGameObject(world, behaviour.objectId).isAlive)
+		{
+			m_resuming.push_back(behaviourIndex);
+			return true;
+		}
+		if (!IsObjectInActiveWorldChunk(world, behaviour.objectId))
+		{
+			m_delays.Schedule(behaviour.objectId, behaviourIndex, time.elapsedTime + inactiveConditionDelay);
+			return true;
+		}
+		if (behaviour.handle.promise().wait.condition(world, behaviour.objectId))
+		{
+			m_resuming.push_back(behaviourIndex);
+			return true;
+		}
+		return false;
+	};
+	m_waitingForCondition.erase(remove_if(begin(m_waitingForCondition), end(m_waitingForCondition), conditionMet), end(m_waitingForCondition));
+
+	for (uint32_t behaviourIndex : m_resuming)
+	{
+		Resume(world, behaviourIndex, time);
+	}
+
+	return static_cast<int>(m_resuming.size());
+}
+
+
+void AICoroutineScheduler::Resume(World& world, uint32_t behaviourIndex, const Time& time)
+{
+	auto behaviour = m_behaviours[behaviourIndex];
+	if (!GetGameObject(world, behaviour.objectId).isAlive)
+	{
+		Destroy(behaviourIndex);
+		return;
+	}
+
+	behaviour.handle.resume();
+	if (behaviour.handle.done())
+	{
+		Destroy(behaviourIndex);
+		return;
+	}
+
+	const auto& wait = behaviour.handle.promise().wait;
+	switch (wait.type)
+	{
+	case AIWait::Type::NextFrame:
+		m_nextFrame.push_back(behaviourIndex);
+		break;
+	case AIWait::Type::Delay:
+		m_delays.Schedule(behaviour.objectId, behaviourIndex, time.elapsedTime + wait.delay);
+		break;
+	case AIWait::Type::Condition:
+		m_waitingForCondition.push_back(behaviourIndex);
+		break;
+	}
+}
+
+
+void AICoroutineScheduler::Destroy(uint32_t behaviourIndex)
+{
+	auto& behaviour = m_behaviours[behaviourIndex];
+	behaviour.handle.destroy();
+	behaviour = Behaviour {};
+	m_freeBehaviours.push_back(behaviourIndex);
+}
+
+
+void AICoroutineScheduler::Clear(float elapsedTime)
+{
+	for (auto& behaviour : m_behaviours)
+	{
+		if (behaviour.handle)
+			behaviour.handle.destroy();
+	}
+	m_behaviours.clear();
+	m_freeBehaviours.clear();
+	m_nextFrame.clear();
+	m_waitingForCondition.clear();
+	m_delays.Reset(elapsedTime);
+}
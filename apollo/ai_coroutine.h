@@ -0,0 +1,170 @@
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "game.h"
+#include "timer_wheel.h"
+
+struct World;
+
+// Coroutine frames are allocated from fixed size blocks so that starting a behaviour doesn't hit the heap.
+// Each world has its own pool, a frame remembers which pool it came from so that it can be returned to it.
+class AICoroutineFramePool
+{
+public:
+	static const size_t BlockSize = 512;
+	static const size_t BlocksPerChunk = 64;
+
+	void* Allocate(size_t size);
+	void Free(void* block, size_t size);
+
+	size_t GetBlocksInUse() const { return m_blocksInUse; }
+	size_t GetOversizedAllocations() const { return m_oversizedAllocations; }
+
+private:
+	struct FreeBlock
+	{
+		FreeBlock* next;
+	};
+
+	FreeBlock* m_freeList { nullptr };
+	std::vector<std::unique_ptr<uint8_t[]>> m_chunks;
+	size_t m_blocksInUse { 0 };
+	size_t m_oversizedAllocations { 0 };
+};
+
+
+// What a suspended behaviour is waiting for before the scheduler resumes it.
+struct AIWait
+{
+	enum class Type { NextFrame, Delay, Condition };
+	Type type { Type::NextFrame };
+	float delay { 0.0f };
+	bool (*condition)(const World&, ObjectId) { nullptr };
+};
+
+
+// The return type of an AI behaviour coroutine. Behaviours start suspended and are run by the AICoroutineScheduler.
+// Every behaviour takes the world and the object it belongs to as its first two parameters, its frame comes from the
+// pool of that world. A behaviour owns its frame until it is started, and destroys it if it never is.
+class AIBehaviour
+{
+public:
+	struct promise_type
+	{
+		AIBehaviour get_return_object() { return AIBehaviour { std::coroutine_handle<promise_type>::from_promise(*this) }; }
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		std::suspend_always final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+
+		static void* operator new(size_t size, World& world, ObjectId objectId);
+		static void operator delete(void* frame, size_t size);
+
+		AIWait wait;
+	};
+
+	explicit AIBehaviour(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+	AIBehaviour(AIBehaviour&& other) noexcept : m_handle(std::exchange(other.m_handle, nullptr)) {}
+	AIBehaviour& operator=(AIBehaviour&& other) noexcept
+	{
+		if (this != &other)
+		{
+			if (m_handle)
+				m_handle.destroy();
+			m_handle = std::exchange(other.m_handle, nullptr);
+		}
+		return *this;
+	}
+	AIBehaviour(const AIBehaviour&) = delete;
+	AIBehaviour& operator=(const AIBehaviour&) = delete;
+	~AIBehaviour()
+	{
+		if (m_handle)
+			m_handle.destroy();
+	}
+
+	// hands the frame over to the caller, who becomes responsible for destroying it
+	std::coroutine_handle<promise_type> Release() { return std::exchange(m_handle, nullptr); }
+
+private:
+	std::coroutine_handle<promise_type> m_handle;
+};
+
+
+// co_await AINextFrame {} resumes the behaviour on the next AI update
+struct AINextFrame
+{
+	bool await_ready() const noexcept { return false; }
+	void await_suspend(std::coroutine_handle<AIBehaviour::promise_type> handle) const noexcept { handle.promise().wait = AIWait { AIWait::Type::NextFrame }; }
+	void await_resume() const noexcept {}
+};
+
+// co_await AIDelay { seconds } parks the behaviour on the scheduler's timer wheel until the delay has passed
+struct AIDelay
+{
+	float seconds;
+
+	bool await_ready() const noexcept { return seconds <= 0.0f; }
+	void await_suspend(std::coroutine_handle<AIBehaviour::promise_type> handle) const noexcept { handle.promise().wait = AIWait { AIWait::Type::Delay, seconds }; }
+	void await_resume() const noexcept {}
+};
+
+// co_await AIWaitUntil { world, objectId, condition } resumes the behaviour on the first AI update where the condition holds,
+// outside of the active chunks the condition is only checked every so often
+struct AIWaitUntil
+{
+	const World& world;
+	ObjectId objectId;
+	bool (*condition)(const World&, ObjectId);
+
+	bool await_ready() const { return condition(world, objectId); }
+	void await_suspend(std::coroutine_handle<AIBehaviour::promise_type> handle) const noexcept { handle.promise().wait = AIWait { AIWait::Type::Condition, 0.0f, condition }; }
+	void await_resume() const noexcept {}
+};
+
+
+class AICoroutineScheduler
+{
+public:
+	AICoroutineScheduler() = default;
+	AICoroutineScheduler(const AICoroutineScheduler&) = delete;
+	AICoroutineScheduler& operator=(const AICoroutineScheduler&) = delete;
+	~AICoroutineScheduler();
+
+	// take ownership of a behaviour belonging to a game object, it first runs on the next Update
+	void Start(ObjectId objectId, AIBehaviour&& behaviour);
+
+	// resume every behaviour whose wait is over, destroying those that finish or whose game object has died
+	// returns the number of behaviours resumed
+	int Update(World& world, const Time& time);
+
+	// destroy every behaviour, starting again from elapsedTime
+	void Clear(float elapsedTime);
+
+	size_t GetBehaviourCount() const { return m_behaviours.size() - m_freeBehaviours.size(); }
+
+private:
+	struct Behaviour
+	{
+		ObjectId objectId { 0 };
+		std::coroutine_handle<AIBehaviour::promise_type> handle;
+	};
+
+	void Resume(World& world, uint32_t behaviourIndex, const Time& time);
+	void Destroy(uint32_t behaviourIndex);
+
+	std::vector<Behaviour> m_behaviours;
+	std::vector<uint32_t> m_freeBehaviours;
+	std::vector<uint32_t> m_nextFrame;
+	std::vector<uint32_t> m_waitingForCondition;
+	std::vector<uint32_t> m_resuming;
+	std::vector<TimedAction> m_dueDelays;
+	TimerWheel m_delays;
+};
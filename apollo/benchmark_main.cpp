@@ -0,0 +1,353 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ai.h"
+#include "game.h"
+#include "game_object.h"
+#include "math_helpers.h"
+#include "physics.h"
+#include "player.h"
+#include "profiler.h"
+#include "scope_exit.h"
+#include "spawn_placement.h"
+#include "tweakables.h"
+#include "world.h"
+#include "world_statistics.h"
+
+using namespace std;
+using namespace std::chrono;
+
+
+// Runs named stress scenarios at increasing entity counts for a fixed number of ticks from a fixed seed, and reports
+// how long each system takes per tick, so that regressions and the complexity of each system show up as the counts
+// grow. The whole world is kept active, and the AI budget is disabled so that every system does all of its work.
+
+namespace
+{
+	struct BenchmarkScenario
+	{
+		const char* name;
+		const char* description;
+		void (*setup)(World& world, int count);
+		void (*tick)(World& world, int count); // optional, called before every tick
+	};
+
+	// the profiler blocks reported for each scenario, UpdateWorld covers all of them
+	const char* benchmarkSystems[] = { "UpdateWorld", "UpdateActiveWorldChunks", "UpdateRigidBodies", "UpdateCollision", "DispatchLifecycleEvents", "UpdateAI" };
+	constexpr size_t benchmarkSystemCount = sizeof(benchmarkSystems) / sizeof(benchmarkSystems[0]);
+
+	struct BenchmarkResult
+	{
+		int count { 0 };
+		int liveObjects { 0 };
+		double tickMilliseconds { 0.0 };
+		double systemMilliseconds[benchmarkSystemCount] { };
+	};
+
+
+	void SetupRandomAliens(World& world, int count)
+	{
+		for (int i = 0; i < count; ++i)
+			CreateRandomAlien(world);
+	}
+
+	// every mothership launches a full wave of offspring over its first frames
+	void SetupMotherships(World& world, int count)
+	{
+		for (int i = 0; i < max(1, count / 21); ++i)
+		{
+			Vector2 position, facing;
+			if (FindSpawnPositionInWorld(world, position, facing))
+				SpawnAlien<GameObjectType::AlienMothership>(world, position, facing);
+		}
+	}
+
+	void SetupBulletStorm(World& world, int count)
+	{
+		for (int i = 0; i < count / 10; ++i)
+			CreateRandomAlien(world);
+	}
+
+	// keeps count player bullets in flight, fired from random positions in random directions
+	void TickBulletStorm(World& world, int count)
+	{
+		for (int i = GetLiveBulletCount(world, CollisionLayer::PlayerBullet); i < count; ++i)
+		{
+			const Vector2 position = GetRandomVectorInBox(world.random, world.minWorld, world.maxWorld);
+			CreateBullet(world, position, 600.0f * GetRandomVectorOnCircle(world.random), CollisionLayer::PlayerBullet, CollisionLayer::Alien);
+		}
+	}
+
+	// half wall huggers crossing as often as they can, so the other half end up packed into a shrinking arena
+	void SetupShrunkArena(World& world, int count)
+	{
+		Tweakables::GetInstance().SetFloat("Alien.WallHugger.CrossingProbability", 0.01f);
+		const auto dimensions = GameObjectTraits<GameObjectType::AlienWallHugger>::metaData.GetBoundingBoxDimensions();
+		for (int i = 0; i < count / 2; ++i)
+		{
+			Vector2 position, facing;
+			if (FindSpawnPositionAlongWall(world, dimensions, position, facing))
+				SpawnAlien<GameObjectType::AlienWallHugger>(world, position, facing);
+		}
+		for (int i = count / 2; i < count; ++i)
+			CreateRandomAlien(world);
+	}
+
+	const BenchmarkScenario benchmarkScenarios[] =
+	{
+		{ "aliens", "randomly picked aliens spread over the world", SetupRandomAliens, nullptr },
+		{ "motherships", "motherships launching full waves of offspring", SetupMotherships, nullptr },
+		{ "bullet_storm", "a constant stream of player bullets through a tenth as many aliens", SetupBulletStorm, TickBulletStorm },
+		{ "shrunk_arena", "wall huggers shrinking the arena around the other aliens", SetupShrunkArena, nullptr },
+	};
+
+
+	// sums the duration of the benchmarked blocks in this tick's profile events
+	void AccumulateSystemDurations(BenchmarkResult& result)
+	{
+		thread_local vector<const ProfileEvent*> openEvents;
+		openEvents.clear();
+		for (const auto& event : profileEvents)
+		{
+			if (event.type == ProfileEvent::Type::Begin)
+			{
+				openEvents.push_back(&event);
+				continue;
+			}
+
+			assert(!openEvents.empty() && (openEvents.back()->id == event.id));
+			const auto& beginEvent = *openEvents.back();
+			openEvents.pop_back();
+			for (size_t system = 0; system < benchmarkSystemCount; ++system)
+			{
+				if (strcmp(event.id, benchmarkSystems[system]) == 0)
+					result.systemMilliseconds[system] += duration_cast<duration<double, milli>>(event.time - beginEvent.time).count();
+			}
+		}
+	}
+
+	BenchmarkResult RunScenario(const BenchmarkScenario& scenario, int count, int ticks, uint64_t seed)
+	{
+		auto& tweakables = Tweakables::GetInstance();
+		const auto initialAlienCount = tweakables.GetInt("World.InitialAlienCount");
+		const auto worldSizeMultiplier = tweakables.GetInt("World.SizeMultiplier");
+		const auto aiUpdateBudget = tweakables.GetInt("AI.UpdateBudgetMicroseconds");
+		const auto wallHuggerCrossingProbability = tweakables.GetFloat("Alien.WallHugger.CrossingProbability");
+		auto tweakablesRestorer = make_scope_exit([&] ()
+		{
+			tweakables.SetInt("World.InitialAlienCount", initialAlienCount);
+			tweakables.SetInt("World.SizeMultiplier", worldSizeMultiplier);
+			tweakables.SetInt("AI.UpdateBudgetMicroseconds", aiUpdateBudget);
+			tweakables.SetFloat("Alien.WallHugger.CrossingProbability", wallHuggerCrossingProbability);
+		});
+
+		// grow the world with the count, keeping roughly a hundred objects per window sized area
+		tweakables.SetInt("World.InitialAlienCount", 0);
+		tweakables.SetInt("World.SizeMultiplier", min(max(static_cast<int>(ceil(sqrt(count / 100.0))), 1), 10));
+		tweakables.SetInt("AI.UpdateBudgetMicroseconds", 0);
+
+		auto world = make_unique<World>();
+		SeedRandom(world->random, seed);
+		InitPhysics(*world);
+		InitAI(*world);
+		InitWorld(*world);
+
+		// a camera that sees the whole world keeps every chunk active
+		world->camera.viewSize = world->initialMaxWorld - world->initialMinWorld;
+
+		scenario.setup(*world, count);
+		DispatchLifecycleEvents(*world);
+
+		BenchmarkResult result;
+		result.count = count;
+
+		Time time;
+		const PlayerInput playerInput;
+		for (int tick = 0; tick < ticks; ++tick)
+		{
+			PROFILER_BEGIN_FRAME();
+			time.deltaTime = 1.0f / 60.0f;
+			time.elapsedTime += time.deltaTime;
+
+			if (scenario.tick)
+				scenario.tick(*world, count);
+
+			const auto tickStartTime = high_resolution_clock::now();
+			ApplyPlayerInput(*world, time, playerInput);
+			UpdateWorld(*world, time);
+			result.tickMilliseconds += duration_cast<duration<double, milli>>(high_resolution_clock::now() - tickStartTime).count();
+
+			AccumulateSystemDurations(result);
+		}
+
+		result.tickMilliseconds /= ticks;
+		for (auto& systemMilliseconds : result.systemMilliseconds)
+			systemMilliseconds /= ticks;
+		result.liveObjects = GetLiveAlienCount(*world) + GetLiveBulletCount(*world, CollisionLayer::PlayerBullet) + GetLiveBulletCount(*world, CollisionLayer::Alien);
+		return result;
+	}
+
+
+	// how the cost grows between two counts, 1 is linear and 2 quadratic
+	double GetScalingExponent(double millisecondsA, int countA, double millisecondsB, int countB)
+	{
+		if ((millisecondsA <= 0.0) || (millisecondsB <= 0.0) || (countA == countB))
+			return 0.0;
+		return log(millisecondsB / millisecondsA) / log(static_cast<double>(countB) / countA);
+	}
+
+	void PrintScenarioResults(const BenchmarkScenario& scenario, const vector<BenchmarkResult>& results)
+	{
+		printf("\n%s: %s\n", scenario.name, scenario.description);
+		printf("%8s %8s %10s", "count", "live", "tick ms");
+		for (const auto* system : benchmarkSystems)
+			printf(" %24s", system);
+		printf("\n");
+
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			const auto& result = results[i];
+			printf("%8d %8d %10.3f", result.count, result.liveObjects, result.tickMilliseconds);
+			for (const auto systemMilliseconds : result.systemMilliseconds)
+				printf(" %24.3f", systemMilliseconds);
+			printf("\n");
+
+			if (i > 0)
+			{
+				const auto& previous = results[i - 1];
+				printf("%8s %8s %10.2f", "exponent", "", GetScalingExponent(previous.tickMilliseconds, previous.count, result.tickMilliseconds, result.count));
+				for (size_t system = 0; system < benchmarkSystemCount; ++system)
+					printf(" %24.2f", GetScalingExponent(previous.systemMilliseconds[system], previous.count, result.systemMilliseconds[system], result.count));
+				printf("\n");
+			}
+		}
+	}
+
+	void WriteCSV(ostream& stream, const vector<pair<const BenchmarkScenario*, vector<BenchmarkResult>>>& scenarioResults)
+	{
+		stream << "scenario,count,liveObjects,tickMs";
+		for (const auto* system : benchmarkSystems)
+			stream << ',' << system << "Ms";
+		stream << '\n';
+
+		for (const auto& [scenario, results] : scenarioResults)
+		{
+			for (const auto& result : results)
+			{
+				stream << scenario->name << ',' << result.count << ',' << result.liveObjects << ',' << result.tickMilliseconds;
+				for (const auto systemMilliseconds : result.systemMilliseconds)
+					stream << ',' << systemMilliseconds;
+				stream << '\n';
+			}
+		}
+	}
+
+
+	void PrintUsage()
+	{
+		printf("usage: apollo_benchmark [options]\n");
+		printf("  --scenario NAME     run only the named scenario, may be repeated\n");
+		printf("  --counts A,B,C      entity counts to run each scenario at (default 100,1000,10000)\n");
+		printf("  --ticks N           ticks to run each scenario for (default 300)\n");
+		printf("  --seed N            random seed of every world (default 1)\n");
+		printf("  --csv FILE          also write the results as CSV\n");
+		printf("scenarios:\n");
+		for (const auto& scenario : benchmarkScenarios)
+			printf("  %-20s%s\n", scenario.name, scenario.description);
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	vector<const BenchmarkScenario*> scenarios;
+	vector<int> counts;
+	int ticks = 300;
+	uint64_t seed = 1;
+	const char* csvFilename = nullptr;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		const bool hasValue = (i + 1 < argc);
+		if ((strcmp(arg, "--scenario") == 0) && hasValue)
+		{
+			const char* name = argv[++i];
+			auto scenarioIter = find_if(begin(benchmarkScenarios), end(benchmarkScenarios), [name] (const BenchmarkScenario& scenario) { return strcmp(scenario.name, name) == 0; });
+			if (scenarioIter == end(benchmarkScenarios))
+			{
+				printf("Unknown scenario: %s\n", name);
+				PrintUsage();
+				return 1;
+			}
+			scenarios.push_back(&*scenarioIter);
+		}
+		else if ((strcmp(arg, "--counts") == 0) && hasValue)
+		{
+			for (char* count = argv[++i]; *count; )
+			{
+				counts.push_back(static_cast<int>(strtol(count, &count, 10)));
+				if (*count == ',')
+					++count;
+				else if (*count)
+					break;
+			}
+		}
+		else if ((strcmp(arg, "--ticks") == 0) && hasValue)
+			ticks = atoi(argv[++i]);
+		else if ((strcmp(arg, "--seed") == 0) && hasValue)
+			seed = strtoull(argv[++i], nullptr, 10);
+		else if ((strcmp(arg, "--csv") == 0) && hasValue)
+			csvFilename = argv[++i];
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	if (scenarios.empty())
+	{
+		for (const auto& scenario : benchmarkScenarios)
+			scenarios.push_back(&scenario);
+	}
+	if (counts.empty())
+		counts = { 100, 1000, 10000 };
+	if ((ticks <= 0) || any_of(begin(counts), end(counts), [] (int count) { return count <= 0; }))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	ProfilerInit();
+	auto profilerQuiter = make_scope_exit(ProfilerShutdown);
+
+	printf("%d ticks per run, seed %llu, milliseconds per tick\n", ticks, static_cast<unsigned long long>(seed));
+
+	vector<pair<const BenchmarkScenario*, vector<BenchmarkResult>>> scenarioResults;
+	for (const auto* scenario : scenarios)
+	{
+		vector<BenchmarkResult> results;
+		for (const auto count : counts)
+			results.push_back(RunScenario(*scenario, count, ticks, seed));
+		PrintScenarioResults(*scenario, results);
+		scenarioResults.emplace_back(scenario, move(results));
+	}
+
+	if (csvFilename)
+	{
+		ofstream file(csvFilename);
+		WriteCSV(file, scenarioResults);
+	}
+
+	return 0;
+}
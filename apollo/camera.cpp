@@ -0,0 +1,55 @@
+#include "camera.h"
+
+#include <algorithm>
+
+#include "glm/gtc/matrix_transform.hpp"
+
+using namespace std;
+
+
+namespace
+{
+	float ClampCameraAxis(float target, float halfViewSize, float boundsMin, float boundsMax)
+	{
+		if (boundsMax - boundsMin <= 2.0f * halfViewSize)
+			return 0.5f * (boundsMin + boundsMax);
+		return min(max(target, boundsMin + halfViewSize), boundsMax - halfViewSize);
+	}
+}
+
+
+void UpdateCamera(Camera& camera, const Vector2& target, const Vector2& boundsMin, const Vector2& boundsMax)
+{
+	const Vector2 halfViewSize = 0.5f * camera.viewSize;
+	camera.position.x = ClampCameraAxis(target.x, halfViewSize.x, boundsMin.x, boundsMax.x);
+	camera.position.y = ClampCameraAxis(target.y, halfViewSize.y, boundsMin.y, boundsMax.y);
+}
+
+
+Vector2 GetCameraViewMin(const Camera& camera)
+{
+	return camera.position - 0.5f * camera.viewSize;
+}
+
+
+Vector2 GetCameraViewMax(const Camera& camera)
+{
+	return camera.position + 0.5f * camera.viewSize;
+}
+
+
+Camera ApplyCameraView(const Camera& camera, const CameraView& view)
+{
+	Camera viewCamera = camera;
+	viewCamera.position += view.pan;
+	viewCamera.viewSize /= view.zoom;
+	return viewCamera;
+}
+
+
+Matrix4x4 CalculateCameraProjectionMatrix(const Camera& camera)
+{
+	const Vector2 viewMin = GetCameraViewMin(camera);
+	const Vector2 viewMax = GetCameraViewMax(camera);
+	return glm::ortho(viewMin.x, viewMax.x, viewMin.y, viewMax.y, -10.0f, 10.0f);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "math_helpers.h"
+
+
+// The view onto the world. It follows a target, usually the player, but stops at the edges of the bounds rather than
+// showing past them, unless the bounds are smaller than the view in which case they are centred. The active world
+// chunks surround it.
+struct Camera
+{
+	Vector2 position { 0.0f, 0.0f };
+	Vector2 viewSize { 1280.0f, 720.0f }; // in world units
+};
+
+// The viewer's zoom and pan on top of the camera. It only changes what is drawn, the simulation and its active chunks
+// still follow the camera.
+struct CameraView
+{
+	float zoom { 1.0f }; // greater than one zooms in
+	Vector2 pan { 0.0f, 0.0f }; // in world units
+};
+
+void UpdateCamera(Camera& camera, const Vector2& target, const Vector2& boundsMin, const Vector2& boundsMax);
+
+// the world space rectangle that the camera can see
+Vector2 GetCameraViewMin(const Camera& camera);
+Vector2 GetCameraViewMax(const Camera& camera);
+
+// the camera as the viewer sees it
+Camera ApplyCameraView(const Camera& camera, const CameraView& view);
+
+Matrix4x4 CalculateCameraProjectionMatrix(const Camera& camera);
@@ -2,9 +2,12 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include "glm/gtc/type_ptr.hpp"
 
+#include "camera.h"
 #include "debug_draw.h"
 #include "gl_helpers.h"
+#include "gpu_profiler.h"
 #include "profiler.h"
+#include "render_queue.h"
 #include "sprite.h"
 
 using namespace std;
@@ -15,72 +18,111 @@ namespace
 	{
 		GLProgram program {};
 		GLint texUniform;
-		GLint modelviewUniform;
 		GLint projectionUniform;
-		GLint colorUniform;
+	};
+
+	// the lines are drawn as quads one unit wide, textured with the line sprite from the atlas
+	struct DebugDrawVertex
+	{
+		GLfloat position[2];
+		GLfloat uv[2];
+		GLubyte color[4];
 	};
 
 	static DebugDrawShader debugDrawShader;
+	static const SpriteAtlas* spriteAtlas;
 	static Sprite lineSprite;
 
-	struct Line
+	// the world's lines are drawn with the camera, the overlay's in window space over the top of everything else
+	struct DebugDrawLines
 	{
-		Vector2 begin;
-		Vector2 end;
-		Color color;
+		vector<DebugDrawVertex> vertices;
+		GLStreamBuffer vertexBuffer;
 	};
 
-	static vector<Line> lines;
-
+	static DebugDrawLines worldLines;
+	static DebugDrawLines overlayLines;
 
-	glm::mat4 CreateDebugDrawSpriteModelviewMatrix(const Sprite& sprite, const Vector2& position, const Vector2& facing)
+	void AddLine(DebugDrawLines& lines, const Vector2& begin, const Vector2& end, Color color)
 	{
-		auto y = glm::vec3 { facing / sprite.dimensions.y, 0.0f };
-		auto z = glm::vec3 { 0.0f, 0.0f, 1.0f };
-		auto x = glm::normalize(glm::cross(y, z)) / sprite.dimensions.x;
-		auto modelviewMatrix = glm::mat4(glm::vec4(x, 0.0f), glm::vec4(y, 0.0f), glm::vec4(z, 0.0f), glm::vec4(position, 0.0f, 1.0f));
-		return modelviewMatrix;
+		const Vector2 lineVector = end - begin;
+		const float lineLength = glm::length(lineVector);
+		if (lineLength == 0.0f)
+			return;
+
+		const Vector2 halfWidth = 0.5f * Vector2 { lineVector.y, -lineVector.x } / lineLength;
+		const GLubyte r = static_cast<GLubyte>((static_cast<unsigned int>(color) & 0xff000000) >> 24);
+		const GLubyte g = static_cast<GLubyte>((static_cast<unsigned int>(color) & 0x00ff0000) >> 16);
+		const GLubyte b = static_cast<GLubyte>((static_cast<unsigned int>(color) & 0x0000ff00) >> 8);
+		const GLubyte a = static_cast<GLubyte>((static_cast<unsigned int>(color) & 0x000000ff));
+		auto makeVertex = [r, g, b, a] (const Vector2& position, float u, float v)
+		{
+			return DebugDrawVertex { { position.x, position.y }, { u, v }, { r, g, b, a } };
+		};
+		const auto beginLeft = makeVertex(begin - halfWidth, lineSprite.uvMin.x, lineSprite.uvMax.y);
+		const auto beginRight = makeVertex(begin + halfWidth, lineSprite.uvMax.x, lineSprite.uvMax.y);
+		const auto endRight = makeVertex(end + halfWidth, lineSprite.uvMax.x, lineSprite.uvMin.y);
+		const auto endLeft = makeVertex(end - halfWidth, lineSprite.uvMin.x, lineSprite.uvMin.y);
+		lines.vertices.insert(lines.vertices.end(), { beginLeft, beginRight, endLeft, endLeft, beginRight, endRight });
 	}
 
-	static glm::mat4 CreateDebugDrawSpriteBottomLeftModelviewMatrix(const Sprite& sprite, const Vector2& position, const Vector2& facing)
+	void AddBox2d(DebugDrawLines& lines, const Vector2& min, const Vector2& max, Color color)
 	{
-		return CreateDebugDrawSpriteModelviewMatrix(sprite, position + facing / 2.0f, facing);
+		auto a = Vector2 { min.x, min.y };
+		auto b = Vector2 { min.x, max.y };
+		auto c = Vector2 { max.x, max.y };
+		auto d = Vector2 { max.x, min.y };
+		AddLine(lines, a, b, color);
+		AddLine(lines, b, c, color);
+		AddLine(lines, c, d, color);
+		AddLine(lines, d, a, color);
 	}
 
-	void DrawDebugDrawSprite(const Sprite& sprite, const DebugDrawShader& shader, const glm::mat4& modelviewMatrix, const glm::mat4& projectionMatrix, Color color)
+	struct DebugDrawPacket
 	{
-		glBindBuffer(GL_ARRAY_BUFFER, sprite.vertexBuffer);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sprite.indexBuffer);
-
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(position_uv_vertex), (void*)offsetof(position_uv_vertex, position));
-
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(position_uv_vertex), (void*)offsetof(position_uv_vertex, uv));
-
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, sprite.texture);
-		glUniform1i(shader.texUniform, 0);
-		glUniformMatrix4fv(shader.modelviewUniform, 1, GL_FALSE, glm::value_ptr(modelviewMatrix));
-		glUniformMatrix4fv(shader.projectionUniform, 1, GL_FALSE, glm::value_ptr(projectionMatrix));
-		float r = static_cast<float>((static_cast<unsigned int>(color) & 0xff000000) >> 24) / 255.0f;
-		float g = static_cast<float>((static_cast<unsigned int>(color) & 0x00ff0000) >> 16) / 255.0f;
-		float b = static_cast<float>((static_cast<unsigned int>(color) & 0x0000ff00) >> 8) / 255.0f;
-		float a = static_cast<float>((static_cast<unsigned int>(color) & 0x000000ff)) / 255.0f;
-		glUniform4f(shader.colorUniform, r, g, b, a);
-
-		glDrawElements(GL_TRIANGLES, sprite.indexCount, GL_UNSIGNED_SHORT, 0);
+		DebugDrawLines* lines;
+		glm::mat4 projectionMatrix;
+	};
 
-		glDisableVertexAttribArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	void ExecuteDebugDrawPacket(const DebugDrawPacket& packet)
+	{
+		GPU_PROFILER_TIMER_BEGIN(debug_lines);
+
+		// every line queued by the time the queue is executed goes in one draw
+		auto& vertices = packet.lines->vertices;
+		auto& vertexBuffer = packet.lines->vertexBuffer;
+		const auto vertexDataSize = static_cast<GLsizeiptr>(vertices.size() * sizeof(DebugDrawVertex));
+		const auto vertexOffset = vertexBuffer.Write(vertices.data(), vertexDataSize);
+		if (vertexBuffer == 0)
+		{
+			vertices.clear();
+			return;
+		}
+
+		CachedUseProgram(debugDrawShader.program);
+		CachedSetVertexAttribArrays(0x7);
+		CachedSetBlend(true, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(DebugDrawVertex), (void*)(vertexOffset + offsetof(DebugDrawVertex, position)));
+		CachedVertexAttribDivisor(0, 0);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(DebugDrawVertex), (void*)(vertexOffset + offsetof(DebugDrawVertex, uv)));
+		CachedVertexAttribDivisor(1, 0);
+		glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(DebugDrawVertex), (void*)(vertexOffset + offsetof(DebugDrawVertex, color)));
+		CachedVertexAttribDivisor(2, 0);
+
+		CachedBindTexture(0, spriteAtlas->texture);
+		CachedUniform1i(debugDrawShader.texUniform, 0);
+		glUniformMatrix4fv(debugDrawShader.projectionUniform, 1, GL_FALSE, glm::value_ptr(packet.projectionMatrix));
+
+		glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(vertices.size()));
+		vertices.clear();
 
 		CheckOpenGLErrors();
 	}
 }
 
 
-void DebugDrawInit()
+void DebugDrawInit(const SpriteAtlas& atlas)
 {
 	debugDrawShader.program = LoadShaders("debug_vs.glsl", "debug_fs.glsl");
 
@@ -91,13 +133,6 @@ void DebugDrawInit()
 		CheckOpenGLErrors();
 	}
 
-	debugDrawShader.modelviewUniform = glGetUniformLocation(debugDrawShader.program, "u_modelview");
-	if (debugDrawShader.modelviewUniform == -1)
-	{
-		printf("Unable to find uniform u_modelview in player shader.\n");
-		CheckOpenGLErrors();
-	}
-
 	debugDrawShader.projectionUniform = glGetUniformLocation(debugDrawShader.program, "u_projection");
 	if (debugDrawShader.projectionUniform == -1)
 	{
@@ -105,29 +140,26 @@ void DebugDrawInit()
 		CheckOpenGLErrors();
 	}
 
-	debugDrawShader.colorUniform = glGetUniformLocation(debugDrawShader.program, "u_color");
-	if (debugDrawShader.colorUniform == -1)
-	{
-		printf("Unable to find uniform u_color in debug draw shader.\n");
-		CheckOpenGLErrors();
-	}
-
-	lineSprite = CreateSprite("debug_line.png");
+	spriteAtlas = &atlas;
+	lineSprite = GetSprite(atlas, "debug_line.png");
 	CheckOpenGLErrors();
 }
 
 void DebugDrawShutdown()
 {
+	worldLines.vertexBuffer.Destroy();
+	overlayLines.vertexBuffer.Destroy();
 }
 
 void DebugDrawClear()
 {
-	lines.clear();
+	worldLines.vertices.clear();
+	overlayLines.vertices.clear();
 }
 
 void DebugDrawLine(const Vector2& begin, const Vector2& end, Color color)
 {
-	lines.push_back(Line { begin, end, color });
+	AddLine(worldLines, begin, end, color);
 }
 
 void DebugDrawBox(const glm::mat4& transform, float w, float h, Color color)
@@ -148,36 +180,34 @@ void DebugDrawBox(const glm::mat4& transform, float w, float h, Color color)
 
 void DebugDrawBox2d(const Vector2& min, const Vector2& max, Color color)
 {
-	auto a = Vector2 { min.x, min.y };
-	auto b = Vector2 { min.x, max.y };
-	auto c = Vector2 { max.x, max.y };
-	auto d = Vector2 { max.x, min.y };
-	DebugDrawLine(a, b, color);
-	DebugDrawLine(b, c, color);
-	DebugDrawLine(c, d, color);
-	DebugDrawLine(d, a, color);
+	AddBox2d(worldLines, min, max, color);
 }
 
-void DebugDrawRender(const Time& /*time*/, int windowWidth, int windowHeight)
+void DebugDrawOverlayLine(const Vector2& begin, const Vector2& end, Color color)
 {
-	PROFILER_TIMER_FUNCTION();
+	AddLine(overlayLines, begin, end, color);
+}
 
-	glUseProgram(debugDrawShader.program);
+void DebugDrawOverlayBox2d(const Vector2& min, const Vector2& max, Color color)
+{
+	AddBox2d(overlayLines, min, max, color);
+}
 
-	auto projectionMatrix = glm::ortho(-windowWidth / 2.0f, windowWidth / 2.0f, -windowHeight / 2.0f, windowHeight / 2.0f, -10.0f, 10.0f);
+void DebugDrawRender(RenderQueue& renderQueue, const Camera& camera, const Time& /*time*/, int windowWidth, int windowHeight)
+{
+	PROFILER_TIMER_FUNCTION();
 
-	for (const auto& line : lines)
+	if (!worldLines.vertices.empty())
 	{
-		float lineLength = glm::length(line.end - line.begin);
-		if (lineLength == 0.0f)
-			continue;
-
-		auto modelviewMatrix = CreateDebugDrawSpriteBottomLeftModelviewMatrix(lineSprite, line.begin, line.end - line.begin);
-		DrawDebugDrawSprite(lineSprite, debugDrawShader, modelviewMatrix, projectionMatrix, line.color);
+		const DebugDrawPacket packet { &worldLines, CalculateCameraProjectionMatrix(camera) };
+		SubmitRenderPacket<DebugDrawPacket, ExecuteDebugDrawPacket>(renderQueue, MakeRenderSortKey(RenderLayer::Debug, RenderShader::DebugDraw, spriteAtlas->texture, 0), packet);
 	}
-	lines.clear();
-
-	glUseProgram(0);
 
-	CheckOpenGLErrors();
+	if (!overlayLines.vertices.empty())
+	{
+		const float halfWidth = windowWidth / 2.0f;
+		const float halfHeight = windowHeight / 2.0f;
+		const DebugDrawPacket packet { &overlayLines, glm::ortho(-halfWidth, halfWidth, -halfHeight, halfHeight, -10.0f, 10.0f) };
+		SubmitRenderPacket<DebugDrawPacket, ExecuteDebugDrawPacket>(renderQueue, MakeRenderSortKey(RenderLayer::Profiler, RenderShader::DebugDraw, spriteAtlas->texture, 0), packet);
+	}
 }
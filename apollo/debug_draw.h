@@ -3,10 +3,17 @@
 #include "math_helpers.h"
 #include "rendering.h"
 
-void DebugDrawInit();
+struct Camera;
+struct RenderQueue;
+struct SpriteAtlas;
+
+void DebugDrawInit(const SpriteAtlas& spriteAtlas);
 void DebugDrawShutdown();
 void DebugDrawClear();
 void DebugDrawLine(const Vector2& begin, const Vector2& end, Color color);
 void DebugDrawBox(const glm::mat4& transform, float w, float h, Color color);
 void DebugDrawBox2d(const Vector2& min, const Vector2& max, Color color);
-void DebugDrawRender(const Time& time, int windowWidth, int windowHeight);
+// the overlay is in window space, centred on the window with y up, and is drawn over the ui rather than with the camera
+void DebugDrawOverlayLine(const Vector2& begin, const Vector2& end, Color color);
+void DebugDrawOverlayBox2d(const Vector2& min, const Vector2& max, Color color);
+void DebugDrawRender(RenderQueue& renderQueue, const Camera& camera, const Time& time, int windowWidth, int windowHeight);
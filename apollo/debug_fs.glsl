@@ -2,13 +2,13 @@
 precision mediump float;
 
 in vec2 v_texCoord;
+in vec4 v_color;
 
 layout(location = 0) out vec4 fragColor;
 
 uniform sampler2D s_texture;
-uniform vec4 u_color;
 
 void main()
 {
-	fragColor = u_color * texture(s_texture, v_texCoord);
+	fragColor = v_color * texture(s_texture, v_texCoord);
 }
@@ -1,11 +1,13 @@
 #version 300 es
 layout(location = 0) in vec4 a_position;
 layout(location = 1) in vec2 a_texcoord;
+layout(location = 2) in vec4 a_color;
 out vec2 v_texCoord;
-uniform mat4 u_modelview;
+out vec4 v_color;
 uniform mat4 u_projection;
 void main()
 {
-	gl_Position = u_projection * u_modelview * a_position;
+	gl_Position = u_projection * a_position;
 	v_texCoord = a_texcoord;
+	v_color = a_color;
 }
@@ -0,0 +1,162 @@
+#include "flow_field.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "physics.h"
+#include "profiler.h"
+#include "world.h"
+#include "world_chunks.h"
+
+using namespace std;
+
+
+namespace
+{
+	int GetFlowFieldCellX(const FlowField& field, float x)
+	{
+		return min(max(static_cast<int>((x - field.origin.x) / field.cellSize), 0), field.width - 1);
+	}
+
+	int GetFlowFieldCellY(const FlowField& field, float y)
+	{
+		return min(max(static_cast<int>((y - field.origin.y) / field.cellSize), 0), field.height - 1);
+	}
+
+	int GetFlowFieldCellIndex(const FlowField& field, const Vector2& position)
+	{
+		return GetFlowFieldCellY(field, position.y) * field.width + GetFlowFieldCellX(field, position.x);
+	}
+
+	Vector2 GetOffspringHeading(const RigidBody& rigidBody)
+	{
+		return (glm::length(rigidBody.velocity) > 0.0f) ? glm::normalize(rigidBody.velocity) : Vector2 { 0.0f, 0.0f };
+	}
+}
+
+
+void BuildFlowField(World& world)
+{
+	PROFILER_TIMER_FUNCTION();
+
+	// only the part of the world in the active chunks is covered, and it shrinks as the wall huggers build walls,
+	// so the grid is resized every frame
+	auto& flowField = world.flowField;
+	const Vector2 fieldMin = glm::max(world.minWorld, GetActiveWorldChunksMin(world.chunks));
+	const Vector2 fieldMax = glm::max(glm::min(world.maxWorld, GetActiveWorldChunksMax(world.chunks)), fieldMin);
+	flowField.origin = fieldMin;
+	flowField.width = max(1, static_cast<int>(ceil((fieldMax.x - fieldMin.x) / flowField.cellSize)));
+	flowField.height = max(1, static_cast<int>(ceil((fieldMax.y - fieldMin.y) / flowField.cellSize)));
+	flowField.cells.assign(flowField.width * flowField.height, FlowFieldCell {});
+
+	// scatter the active aliens into their cells
+	for (const auto objectId : world.chunks.activeObjectIds)
+	{
+		const auto type = GetType(objectId);
+		if ((type == GameObjectType::Player) || (type == GameObjectType::Bullet) || !GetGameObject(world, objectId).isAlive)
+			continue;
+
+		const auto& rigidBody = GetRigidBody(world, objectId);
+		auto& cell = flowField.cells[GetFlowFieldCellIndex(flowField, rigidBody.position)];
+		cell.alienPositionSum += rigidBody.position;
+		++cell.alienCount;
+		if (type == GameObjectType::AlienOffspring)
+		{
+			cell.offspringPositionSum += rigidBody.position;
+			cell.offspringHeadingSum += GetOffspringHeading(rigidBody);
+			++cell.offspringCount;
+		}
+	}
+
+	// point every cell towards the player
+	flowField.playerPosition = GetRigidBody(world, world.player.objectId).position;
+	flowField.playerCellIndex = GetFlowFieldCellIndex(flowField, flowField.playerPosition);
+	for (int y = 0; y < flowField.height; ++y)
+	{
+		for (int x = 0; x < flowField.width; ++x)
+		{
+			Vector2 cellCenter = flowField.origin + flowField.cellSize * Vector2 { x + 0.5f, y + 0.5f };
+			Vector2 toPlayer = flowField.playerPosition - cellCenter;
+			float distance = glm::length(toPlayer);
+			flowField.cells[y * flowField.width + x].playerDirection = (distance > 0.0f) ? toPlayer / distance : Vector2 { 0.0f, 0.0f };
+		}
+	}
+}
+
+
+FlowFieldNeighborhood SampleFlowField(const World& world, ObjectId objectId, const RigidBody& rigidBody)
+{
+	const auto& flowField = world.flowField;
+	FlowFieldNeighborhood neighborhood;
+	if (flowField.cells.empty())
+		return neighborhood;
+
+	const Vector2 position = rigidBody.position;
+	const int cellX = GetFlowFieldCellX(flowField, position.x);
+	const int cellY = GetFlowFieldCellY(flowField, position.y);
+	const int cellIndex = cellY * flowField.width + cellX;
+	const bool isOffspring = (GetType(objectId) == GameObjectType::AlienOffspring);
+
+	// the cell centre is a poor approximation when we share a cell with the player
+	if (cellIndex == flowField.playerCellIndex)
+	{
+		Vector2 toPlayer = flowField.playerPosition - position;
+		float distance = glm::length(toPlayer);
+		neighborhood.playerDirection = (distance > 0.0f) ? toPlayer / distance : Vector2 { 0.0f, 0.0f };
+	}
+	else
+	{
+		neighborhood.playerDirection = flowField.cells[cellIndex].playerDirection;
+	}
+
+	Vector2 offspringPositionSum { 0.0f, 0.0f };
+	Vector2 offspringHeadingSum { 0.0f, 0.0f };
+
+	for (int y = max(cellY - 1, 0); y <= min(cellY + 1, flowField.height - 1); ++y)
+	{
+		for (int x = max(cellX - 1, 0); x <= min(cellX + 1, flowField.width - 1); ++x)
+		{
+			const int index = y * flowField.width + x;
+			const auto& cell = flowField.cells[index];
+
+			Vector2 alienPositionSum = cell.alienPositionSum;
+			int alienCount = cell.alienCount;
+			Vector2 cellOffspringPositionSum = cell.offspringPositionSum;
+			Vector2 cellOffspringHeadingSum = cell.offspringHeadingSum;
+			int offspringCount = cell.offspringCount;
+
+			// remove ourselves from our own cell
+			if ((index == cellIndex) && (alienCount > 0))
+			{
+				alienPositionSum -= position;
+				--alienCount;
+				if (isOffspring && (offspringCount > 0))
+				{
+					cellOffspringPositionSum -= position;
+					cellOffspringHeadingSum -= GetOffspringHeading(rigidBody);
+					--offspringCount;
+				}
+			}
+
+			if (alienCount > 0)
+			{
+				Vector2 centroid = alienPositionSum / static_cast<float>(alienCount);
+				if (glm::distance(centroid, position) > 0.0f)
+					neighborhood.alienRepulsion += static_cast<float>(alienCount) * glm::normalize(position - centroid);
+				neighborhood.alienCount += alienCount;
+			}
+
+			offspringPositionSum += cellOffspringPositionSum;
+			offspringHeadingSum += cellOffspringHeadingSum;
+			neighborhood.offspringCount += offspringCount;
+		}
+	}
+
+	if (neighborhood.offspringCount > 0.0f)
+	{
+		neighborhood.offspringCentroid = offspringPositionSum / neighborhood.offspringCount;
+		neighborhood.offspringHeading = offspringHeadingSum / neighborhood.offspringCount;
+	}
+
+	return neighborhood;
+}
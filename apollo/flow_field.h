@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+
+#include "game.h"
+#include "math_helpers.h"
+
+struct RigidBody;
+struct World;
+
+
+// A coarse grid over the active part of the world that is rebuilt once per frame from the player position and the alien
+// positions. Steering AIs sample their 3x3 neighbourhood of cells instead of searching for nearby aliens themselves.
+struct FlowFieldCell
+{
+	Vector2 playerDirection { 0.0f, 0.0f }; // unit vector from the cell centre towards the player
+	Vector2 alienPositionSum { 0.0f, 0.0f };
+	Vector2 offspringPositionSum { 0.0f, 0.0f };
+	Vector2 offspringHeadingSum { 0.0f, 0.0f };
+	int alienCount { 0 };
+	int offspringCount { 0 };
+};
+
+struct FlowField
+{
+	Vector2 origin { 0.0f, 0.0f };
+	float cellSize { 50.0f };
+	int width { 0 };
+	int height { 0 };
+	int playerCellIndex { 0 };
+	Vector2 playerPosition { 0.0f, 0.0f };
+	std::vector<FlowFieldCell> cells;
+};
+
+void BuildFlowField(World& world);
+
+
+struct FlowFieldNeighborhood
+{
+	Vector2 playerDirection { 0.0f, 0.0f };
+	Vector2 alienRepulsion { 0.0f, 0.0f }; // sum of unit vectors pointing away from each nearby alien, approximated per cell by its centroid
+	float alienCount { 0.0f };
+	Vector2 offspringCentroid { 0.0f, 0.0f };
+	Vector2 offspringHeading { 0.0f, 0.0f }; // average heading of the nearby offspring
+	float offspringCount { 0.0f };
+};
+
+// gather the cells surrounding the rigid body, excluding the contribution of the object itself
+FlowFieldNeighborhood SampleFlowField(const World& world, ObjectId objectId, const RigidBody& rigidBody);
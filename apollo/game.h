@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 enum class GameObjectType : uint8_t
 {
 	Player,
@@ -20,7 +22,22 @@ inline ObjectId CreateObjectId(GameObjectType type, uint32_t index) { return (st
 inline GameObjectType GetType(ObjectId objectId) { return static_cast<GameObjectType>(objectId >> 24); }
 inline uint32_t GetIndex(ObjectId objectId) { return static_cast<uint32_t>(objectId & 0xffffff); }
 
-ObjectId GetNextObjectId(GameObjectType type);
+struct World;
+
+ObjectId GetNextObjectId(World& world, GameObjectType type);
+
+
+enum class CollisionLayer : uint32_t { None = 0, Player = 1, PlayerBullet = 2, Alien = 4, All = 0xffff, PendingDestruction = 0x80000000 };
+
+constexpr CollisionLayer operator&(CollisionLayer lhs, CollisionLayer rhs)
+{
+	return static_cast<CollisionLayer>(static_cast<uint32_t>(lhs) & static_cast<uint32_t>(rhs));
+}
+
+constexpr CollisionLayer operator|(CollisionLayer lhs, CollisionLayer rhs)
+{
+	return static_cast<CollisionLayer>(static_cast<uint32_t>(lhs) | static_cast<uint32_t>(rhs));
+}
 
 
 struct Time
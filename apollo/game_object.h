@@ -1,6 +1,9 @@
 #pragma once
 
+#include <array>
 #include <memory>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "game.h"
@@ -11,7 +14,7 @@
 struct GameObject
 {
 	template <GameObjectType GameObjectTypeT>
-	static GameObject CreateGameObject();
+	static GameObject CreateGameObject(World& world);
 
 	GameObject() = default;
 	GameObject(GameObject&&) = default;
@@ -36,15 +39,180 @@ struct GameObject
 
 
 
+enum class SpawnLocation { None, InWorld, AlongWall, FromParent };
+
 struct GameObjectMetaData
 {
 	GameObjectType type;
+	const char* name;
 	const char* spriteFilename;
 	float mass;
-	Vector2 boundingBoxDimensions;
+	float boundingBoxWidth;
+	float boundingBoxHeight;
+	int score; // awarded to the player for killing one
+	int spawnWeight; // relative chance of being picked by CreateRandomAlien
+	SpawnLocation spawnLocation;
+	CollisionLayer collisionLayer;
+	CollisionLayer collisionLayerMask;
+
+	Vector2 GetBoundingBoxDimensions() const { return Vector2 { boundingBoxWidth, boundingBoxHeight }; }
+};
+
+
+struct AIModelAlienRandom;
+struct AIModelAlienChase;
+struct AIModelAlienShy;
+struct AIModelAlienMothership;
+struct AIModelAlienOffspring;
+struct AIModelAlienWallHugger;
+
+// Everything that differs between the game object types, known at compile time. The spawning, scoring and AI code is
+// generated from these traits by templates, so adding a new type is its enum value plus one specialization here.
+template <GameObjectType Type>
+struct GameObjectTraits;
+
+template <>
+struct GameObjectTraits<GameObjectType::Player>
+{
+	static constexpr GameObjectMetaData metaData { GameObjectType::Player, "Player", "apollo.png", 1.0f, 32.0f, 32.0f, 0, 0, SpawnLocation::None, CollisionLayer::Player, CollisionLayer::Alien };
+	using AIModel = void;
+};
+
+// bullets are put on the layer of whoever fired them
+template <>
+struct GameObjectTraits<GameObjectType::Bullet>
+{
+	static constexpr GameObjectMetaData metaData { GameObjectType::Bullet, "Bullet", "bullet.png", 1.0f, 2.0f, 12.0f, 0, 0, SpawnLocation::None, CollisionLayer::None, CollisionLayer::None };
+	using AIModel = void;
+};
+
+template <>
+struct GameObjectTraits<GameObjectType::AlienRandom>
+{
+	static constexpr GameObjectMetaData metaData { GameObjectType::AlienRandom, "Random", "enemy_random.png", 1.0f, 32.0f, 32.0f, 10, 30, SpawnLocation::InWorld, CollisionLayer::Alien, CollisionLayer::Player | CollisionLayer::PlayerBullet };
+	using AIModel = AIModelAlienRandom;
+};
+
+template <>
+struct GameObjectTraits<GameObjectType::AlienChase>
+{
+	static constexpr GameObjectMetaData metaData { GameObjectType::AlienChase, "Chase", "enemy_chase.png", 1.0f, 32.0f, 32.0f, 10, 30, SpawnLocation::InWorld, CollisionLayer::Alien, CollisionLayer::Player | CollisionLayer::PlayerBullet };
+	using AIModel = AIModelAlienChase;
+};
+
+template <>
+struct GameObjectTraits<GameObjectType::AlienShy>
+{
+	static constexpr GameObjectMetaData metaData { GameObjectType::AlienShy, "Shy", "enemy_shy.png", 1.0f, 32.0f, 32.0f, 10, 20, SpawnLocation::InWorld, CollisionLayer::Alien, CollisionLayer::Player | CollisionLayer::PlayerBullet };
+	using AIModel = AIModelAlienShy;
+};
+
+template <>
+struct GameObjectTraits<GameObjectType::AlienMothership>
+{
+	static constexpr GameObjectMetaData metaData { GameObjectType::AlienMothership, "Mothership", "enemy_mothership.png", 1.0f, 64.0f, 64.0f, 25, 10, SpawnLocation::InWorld, CollisionLayer::Alien, CollisionLayer::Player | CollisionLayer::PlayerBullet };
+	using AIModel = AIModelAlienMothership;
 };
 
-extern std::vector<GameObjectMetaData> gameObjectMetaDatas;
+// offspring are only launched by motherships
+template <>
+struct GameObjectTraits<GameObjectType::AlienOffspring>
+{
+	static constexpr GameObjectMetaData metaData { GameObjectType::AlienOffspring, "Offspring", "enemy_offspring.png", 1.0f, 16.0f, 16.0f, 1, 0, SpawnLocation::FromParent, CollisionLayer::Alien, CollisionLayer::Player | CollisionLayer::PlayerBullet };
+	using AIModel = AIModelAlienOffspring;
+};
+
+template <>
+struct GameObjectTraits<GameObjectType::AlienWallHugger>
+{
+	static constexpr GameObjectMetaData metaData { GameObjectType::AlienWallHugger, "WallHugger", "enemy_wallhugger.png", 1.0f, 24.0f, 24.0f, 10, 10, SpawnLocation::AlongWall, CollisionLayer::Alien, CollisionLayer::Player | CollisionLayer::PlayerBullet };
+	using AIModel = AIModelAlienWallHugger;
+};
+
+
+template <GameObjectType... Types>
+struct GameObjectTypeList
+{
+};
+
+namespace GameObjectTypeListDetail
+{
+	template <typename IndexSequence>
+	struct AllTypes;
+
+	template <size_t... Indices>
+	struct AllTypes<std::index_sequence<Indices...>>
+	{
+		using Type = GameObjectTypeList<static_cast<GameObjectType>(Indices)...>;
+	};
+
+	template <typename... Lists>
+	struct Concat
+	{
+		using Type = GameObjectTypeList<>;
+	};
+
+	template <GameObjectType... Types>
+	struct Concat<GameObjectTypeList<Types...>>
+	{
+		using Type = GameObjectTypeList<Types...>;
+	};
+
+	template <GameObjectType... TypesA, GameObjectType... TypesB, typename... Lists>
+	struct Concat<GameObjectTypeList<TypesA...>, GameObjectTypeList<TypesB...>, Lists...>
+	{
+		using Type = typename Concat<GameObjectTypeList<TypesA..., TypesB...>, Lists...>::Type;
+	};
+
+	template <typename List>
+	struct AITypes;
+
+	template <GameObjectType... Types>
+	struct AITypes<GameObjectTypeList<Types...>>
+	{
+		using Type = typename Concat<std::conditional_t<std::is_void_v<typename GameObjectTraits<Types>::AIModel>, GameObjectTypeList<>, GameObjectTypeList<Types>>...>::Type;
+	};
+}
+
+// every type in GameObjectType order
+using AllGameObjectTypes = typename GameObjectTypeListDetail::AllTypes<std::make_index_sequence<static_cast<size_t>(GameObjectType::Count)>>::Type;
+
+// the types that are controlled by an AI model, the aliens
+using AIGameObjectTypes = typename GameObjectTypeListDetail::AITypes<AllGameObjectTypes>::Type;
+
+// calls function.template operator()<Type>() for every type in the list
+template <GameObjectType... Types, typename Function>
+constexpr void ForEachGameObjectType(GameObjectTypeList<Types...>, Function&& function)
+{
+	(function.template operator()<Types>(), ...);
+}
+
+// calls function.template operator()<Type>() for the type in the list that matches a runtime type, returns false if none does
+template <GameObjectType... Types, typename Function>
+constexpr bool DispatchGameObjectType(GameObjectTypeList<Types...>, GameObjectType type, Function&& function)
+{
+	return (((type == Types) && (function.template operator()<Types>(), true)) || ...);
+}
+
+
+template <GameObjectType... Types>
+constexpr std::array<GameObjectMetaData, sizeof...(Types)> MakeGameObjectMetaDatas(GameObjectTypeList<Types...>)
+{
+	return { GameObjectTraits<Types>::metaData... };
+}
+
+// the traits' metadata indexed by type, for the code that only knows the type at runtime
+constexpr auto gameObjectMetaDatas = MakeGameObjectMetaDatas(AllGameObjectTypes {});
+
+constexpr const GameObjectMetaData& GetGameObjectMetaData(GameObjectType type)
+{
+	return gameObjectMetaDatas[static_cast<size_t>(type)];
+}
+
+template <GameObjectType... Types>
+constexpr bool AreGameObjectMetaDatasInTypeOrder(GameObjectTypeList<Types...>)
+{
+	return ((GameObjectTraits<Types>::metaData.type == Types) && ...);
+}
 
-GameObjectMetaData& GetGameObjectMetaData(GameObjectType type);
-void CreateGameObjectMetaData();
+static_assert(AreGameObjectMetaDatasInTypeOrder(AllGameObjectTypes {}), "each type's traits must describe that type");
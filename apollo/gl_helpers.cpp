@@ -2,10 +2,14 @@
 
 #include "GL/glew.h"
 
+#include <algorithm>
+#include <cassert>
 #include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include <memory>
+#include <unordered_map>
 
 using namespace std;
 
@@ -112,3 +116,302 @@ bool CheckOpenGLErrors()
 }
 
 
+namespace
+{
+	constexpr GLuint unknownState = ~0u;
+	constexpr int cachedTextureUnitCount = 8;
+	constexpr int cachedVertexAttribCount = 16;
+
+	struct GLStateCache
+	{
+		GLuint program { unknownState };
+		GLuint arrayBuffer { unknownState };
+		GLuint elementArrayBuffer { unknownState };
+		GLuint activeTextureUnit { unknownState };
+		GLuint textures[cachedTextureUnitCount];
+		uint32_t vertexAttribArraysEnabled { 0 };
+		bool vertexAttribArraysKnown { false };
+		GLuint vertexAttribDivisors[cachedVertexAttribCount];
+		GLuint blend { unknownState };
+		GLenum blendSourceFactor { unknownState };
+		GLenum blendDestinationFactor { unknownState };
+
+		// uniforms belong to the program, no one else sets ours so they stay valid when the rest of the cache doesn't
+		unordered_map<uint64_t, GLint> uniforms;
+
+		GLStateCacheStatistics frameStatistics;
+		GLStateCacheStatistics lastFrameStatistics;
+
+		GLStateCache()
+		{
+			Invalidate();
+		}
+
+		void Invalidate()
+		{
+			program = unknownState;
+			arrayBuffer = unknownState;
+			elementArrayBuffer = unknownState;
+			activeTextureUnit = unknownState;
+			fill(begin(textures), end(textures), unknownState);
+			vertexAttribArraysKnown = false;
+			fill(begin(vertexAttribDivisors), end(vertexAttribDivisors), unknownState);
+			blend = unknownState;
+			blendSourceFactor = unknownState;
+			blendDestinationFactor = unknownState;
+		}
+
+		// returns true when the call is needed, and remembers the new value
+		template <typename T>
+		bool Update(T& cachedValue, T value)
+		{
+			if (cachedValue == value)
+			{
+				++frameStatistics.elided;
+				return false;
+			}
+			cachedValue = value;
+			++frameStatistics.issued;
+			return true;
+		}
+	};
+
+	GLStateCache stateCache;
+}
+
+void GLStateCacheBeginFrame()
+{
+	stateCache.lastFrameStatistics = stateCache.frameStatistics;
+	stateCache.frameStatistics = GLStateCacheStatistics {};
+	stateCache.Invalidate();
+}
+
+void GLStateCacheInvalidate()
+{
+	stateCache.Invalidate();
+}
+
+void GLStateCacheRestoreDefaults()
+{
+	CachedUseProgram(0);
+	CachedBindBuffer(GL_ARRAY_BUFFER, 0);
+	CachedBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	CachedSetVertexAttribArrays(0);
+	for (GLuint index = 0; index < cachedVertexAttribCount; ++index)
+	{
+		// only the divisors that have been set through the cache are known to need resetting
+		if (stateCache.vertexAttribDivisors[index] != unknownState)
+			CachedVertexAttribDivisor(index, 0);
+	}
+}
+
+const GLStateCacheStatistics& GetGLStateCacheStatistics()
+{
+	return stateCache.lastFrameStatistics;
+}
+
+void CachedUseProgram(GLuint program)
+{
+	if (stateCache.Update(stateCache.program, program))
+		glUseProgram(program);
+}
+
+void CachedBindBuffer(GLenum target, GLuint buffer)
+{
+	auto& cachedBuffer = (target == GL_ELEMENT_ARRAY_BUFFER) ? stateCache.elementArrayBuffer : stateCache.arrayBuffer;
+	assert((target == GL_ARRAY_BUFFER) || (target == GL_ELEMENT_ARRAY_BUFFER));
+	if (stateCache.Update(cachedBuffer, buffer))
+		glBindBuffer(target, buffer);
+}
+
+void CachedBindTexture(GLuint textureUnit, GLuint texture)
+{
+	assert(textureUnit < cachedTextureUnitCount);
+	if (stateCache.textures[textureUnit] == texture)
+	{
+		++stateCache.frameStatistics.elided;
+		return;
+	}
+	if (stateCache.Update(stateCache.activeTextureUnit, textureUnit))
+		glActiveTexture(GL_TEXTURE0 + textureUnit);
+	stateCache.Update(stateCache.textures[textureUnit], texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+void CachedSetVertexAttribArrays(uint32_t enabledMask)
+{
+	// only the arrays enabled before or after would be set without the cache, the others are neither set nor counted
+	const uint32_t allArraysMask = (1u << cachedVertexAttribCount) - 1;
+	const uint32_t changingMask = stateCache.vertexAttribArraysKnown ? (enabledMask | stateCache.vertexAttribArraysEnabled) : allArraysMask;
+	for (GLuint index = 0; index < cachedVertexAttribCount; ++index)
+	{
+		const uint32_t bit = 1u << index;
+		if ((changingMask & bit) == 0)
+			continue;
+		const bool enabled = (enabledMask & bit) != 0;
+		if (stateCache.vertexAttribArraysKnown && (((stateCache.vertexAttribArraysEnabled & bit) != 0) == enabled))
+		{
+			++stateCache.frameStatistics.elided;
+			continue;
+		}
+		++stateCache.frameStatistics.issued;
+		if (enabled)
+			glEnableVertexAttribArray(index);
+		else
+			glDisableVertexAttribArray(index);
+	}
+	stateCache.vertexAttribArraysEnabled = enabledMask;
+	stateCache.vertexAttribArraysKnown = true;
+}
+
+void CachedVertexAttribDivisor(GLuint index, GLuint divisor)
+{
+	assert(index < cachedVertexAttribCount);
+	if (stateCache.Update(stateCache.vertexAttribDivisors[index], divisor))
+		glVertexAttribDivisor(index, divisor);
+}
+
+void CachedSetBlend(bool enabled, GLenum sourceFactor, GLenum destinationFactor)
+{
+	if (stateCache.Update(stateCache.blend, enabled ? 1u : 0u))
+	{
+		if (enabled)
+			glEnable(GL_BLEND);
+		else
+			glDisable(GL_BLEND);
+	}
+	if (!enabled)
+		return;
+	if ((stateCache.blendSourceFactor == sourceFactor) && (stateCache.blendDestinationFactor == destinationFactor))
+	{
+		++stateCache.frameStatistics.elided;
+		return;
+	}
+	stateCache.blendSourceFactor = sourceFactor;
+	stateCache.blendDestinationFactor = destinationFactor;
+	++stateCache.frameStatistics.issued;
+	glBlendFunc(sourceFactor, destinationFactor);
+}
+
+void CachedUniform1i(GLint location, GLint value)
+{
+	assert(stateCache.program != unknownState);
+	const uint64_t key = (static_cast<uint64_t>(stateCache.program) << 32) | static_cast<uint32_t>(location);
+	auto iter = stateCache.uniforms.find(key);
+	if (iter == stateCache.uniforms.end())
+		iter = stateCache.uniforms.emplace(key, value + 1).first;
+	if (stateCache.Update(iter->second, value))
+		glUniform1i(location, value);
+}
+
+
+GLStreamBuffer::GLStreamBuffer(GLenum target)
+	: m_target(target)
+{
+}
+
+GLStreamBuffer::~GLStreamBuffer()
+{
+	assert(m_buffer == 0);
+}
+
+void GLStreamBuffer::Create(GLsizeiptr regionSize)
+{
+	Destroy();
+
+	glGenBuffers(1, &m_buffer);
+	if (m_buffer == 0)
+	{
+		printf("Unable to allocate stream buffer: %s\n", glewGetErrorString(glGetError()));
+		return;
+	}
+	m_regionSize = regionSize;
+	m_region = -1;
+
+	CachedBindBuffer(m_target, m_buffer);
+	m_persistent = GLEW_ARB_buffer_storage || GLEW_VERSION_4_4;
+	if (m_persistent)
+	{
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(m_target, RegionCount * m_regionSize, nullptr, flags);
+		m_mapped = static_cast<uint8_t*>(glMapBufferRange(m_target, 0, RegionCount * m_regionSize, flags));
+		if (!m_mapped)
+		{
+			// fall back to orphaning, the storage of this buffer is immutable now so start again with a new one
+			printf("Unable to map stream buffer: %s\n", glewGetErrorString(glGetError()));
+			glDeleteBuffers(1, &m_buffer);
+			glGenBuffers(1, &m_buffer);
+			CachedBindBuffer(m_target, m_buffer);
+			m_persistent = false;
+		}
+	}
+	if (!m_persistent)
+	{
+		glBufferData(m_target, m_regionSize, nullptr, GL_STREAM_DRAW);
+	}
+}
+
+void GLStreamBuffer::Destroy()
+{
+	for (auto& fence : m_fences)
+	{
+		if (fence)
+			glDeleteSync(fence);
+		fence = nullptr;
+	}
+	if (m_buffer)
+	{
+		if (m_mapped)
+		{
+			CachedBindBuffer(m_target, m_buffer);
+			glUnmapBuffer(m_target);
+		}
+		// deleting a bound buffer unbinds it
+		CachedBindBuffer(m_target, 0);
+		glDeleteBuffers(1, &m_buffer);
+	}
+	m_buffer = 0;
+	m_mapped = nullptr;
+	m_regionSize = 0;
+}
+
+GLintptr GLStreamBuffer::Write(const void* data, GLsizeiptr size)
+{
+	if (size > m_regionSize)
+	{
+		// the old buffer is released once the gpu is done with it
+		Create(max({ size, 2 * m_regionSize, static_cast<GLsizeiptr>(64 * 1024) }));
+		if (m_buffer == 0)
+			return 0;
+	}
+	else
+	{
+		CachedBindBuffer(m_target, m_buffer);
+	}
+
+	if (!m_persistent)
+	{
+		glBufferData(m_target, m_regionSize, nullptr, GL_STREAM_DRAW);
+		glBufferSubData(m_target, 0, size, data);
+		return 0;
+	}
+
+	// everything that read the previous region has been issued by now, fence it before moving on
+	if (m_region >= 0)
+		m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_region = (m_region + 1) % RegionCount;
+
+	// the gpu is normally frames ahead of this region, only wait if it has fallen behind
+	if (m_fences[m_region])
+	{
+		GLenum waitResult = glClientWaitSync(m_fences[m_region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+		while (waitResult == GL_TIMEOUT_EXPIRED)
+			waitResult = glClientWaitSync(m_fences[m_region], 0, 1000000);
+		glDeleteSync(m_fences[m_region]);
+		m_fences[m_region] = nullptr;
+	}
+
+	const GLintptr offset = m_region * m_regionSize;
+	memcpy(m_mapped + offset, data, size);
+	return offset;
+}
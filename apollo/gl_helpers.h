@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include "GL/glew.h"
@@ -67,6 +68,65 @@ GLProgram LoadShaders(const std::string& vertexShaderFilename, const std::string
 bool CheckOpenGLErrors();
 
 
+// Tracks the GL state set through the Cached functions and skips the calls that wouldn't change it. Code that sets GL
+// state itself, like fontstash and ImGui, leaves the cache stale, so invalidate it afterwards, and restore the defaults
+// before it runs when it expects to find them.
+struct GLStateCacheStatistics
+{
+	int issued { 0 };
+	int elided { 0 };
+};
+
+void GLStateCacheBeginFrame();
+void GLStateCacheInvalidate();
+void GLStateCacheRestoreDefaults();
+const GLStateCacheStatistics& GetGLStateCacheStatistics(); // of the last frame
+
+void CachedUseProgram(GLuint program);
+void CachedBindBuffer(GLenum target, GLuint buffer);
+void CachedBindTexture(GLuint textureUnit, GLuint texture); // GL_TEXTURE_2D on GL_TEXTURE0 + textureUnit
+void CachedSetVertexAttribArrays(uint32_t enabledMask); // enables the attribute arrays in the mask and disables the rest
+void CachedVertexAttribDivisor(GLuint index, GLuint divisor);
+void CachedSetBlend(bool enabled, GLenum sourceFactor = GL_ONE, GLenum destinationFactor = GL_ZERO);
+void CachedUniform1i(GLint location, GLint value); // of the program in use
+
+
+// A buffer for data that is rewritten every frame. Where GL_ARB_buffer_storage is available the buffer is persistently
+// mapped and split into regions that are written in turn, with a fence per region so that a region is only rewritten
+// once the gpu has finished reading from it. Otherwise the buffer's storage is orphaned on every write.
+class GLStreamBuffer
+{
+public:
+	static constexpr int RegionCount = 3;
+
+	explicit GLStreamBuffer(GLenum target = GL_ARRAY_BUFFER);
+	GLStreamBuffer(const GLStreamBuffer&) = delete;
+	~GLStreamBuffer();
+
+	GLStreamBuffer& operator=(const GLStreamBuffer&) = delete;
+
+	// copies the data to the next region and leaves the buffer bound, returns the offset of the data in the buffer
+	GLintptr Write(const void* data, GLsizeiptr size);
+
+	// releases the buffer, which has to be done while the gl context is current, the destructor only checks that it was
+	void Destroy();
+
+	operator GLuint() const { return m_buffer; }
+	bool IsPersistent() const { return m_persistent; }
+
+private:
+	void Create(GLsizeiptr regionSize);
+
+	GLenum m_target;
+	GLuint m_buffer { 0 };
+	GLsizeiptr m_regionSize { 0 };
+	int m_region { -1 };
+	bool m_persistent { false };
+	uint8_t* m_mapped { nullptr };
+	GLsync m_fences[RegionCount] {};
+};
+
+
 struct position_uv_vertex
 {
 	GLfloat position[3];
@@ -0,0 +1,178 @@
+#include "gpu_profiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+
+#include "GL/glew.h"
+
+using namespace std;
+
+
+namespace
+{
+	const int frameLatency = 4; // the frames whose queries can be in flight at once
+
+	struct PendingBlock
+	{
+		const char* id;
+		int beginQuery;
+		int endQuery;
+		int depth;
+	};
+
+	struct PendingFrame
+	{
+		vector<GLuint> queries; // kept from frame to frame, and grown as needed
+		int queryCount { 0 };
+		vector<PendingBlock> blocks;
+		GLint64 startTime { 0 }; // the gpu's clock when the frame began on the cpu
+		int frameNumber { 0 };
+		bool pending { false };
+	};
+
+	static bool supported { false };
+	static PendingFrame frames[frameLatency];
+	static PendingFrame* currentFrame { nullptr };
+	static int frameNumber { 0 };
+	static int frameBlock { -1 };
+	static vector<int> openBlocks;
+	static GPUProfilerFrame lastFrame;
+
+	int IssueTimestamp(PendingFrame& frame)
+	{
+		if (frame.queryCount == static_cast<int>(frame.queries.size()))
+		{
+			frame.queries.push_back(0);
+			glGenQueries(1, &frame.queries.back());
+		}
+		glQueryCounter(frame.queries[frame.queryCount], GL_TIMESTAMP);
+		return frame.queryCount++;
+	}
+
+	// the queries complete in order, so the frame is ready once its last query is
+	bool ReadBackFrame(PendingFrame& frame)
+	{
+		assert(frame.pending && (frame.queryCount > 0));
+		GLint available = 0;
+		glGetQueryObjectiv(frame.queries[frame.queryCount - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			return false;
+
+		lastFrame.timings.clear();
+		lastFrame.statistics.clear();
+		for (const auto& block : frame.blocks)
+		{
+			GLuint64 beginTime = 0;
+			GLuint64 endTime = 0;
+			glGetQueryObjectui64v(frame.queries[block.beginQuery], GL_QUERY_RESULT, &beginTime);
+			glGetQueryObjectui64v(frame.queries[block.endQuery], GL_QUERY_RESULT, &endTime);
+			const auto beginOffset = ProfilerDurationUnit { static_cast<GLint64>(beginTime) - frame.startTime };
+			const auto duration = ProfilerDurationUnit { static_cast<GLint64>(endTime - beginTime) };
+			lastFrame.timings.push_back(GPUProfileTiming { block.id, beginOffset, duration, block.depth });
+
+			auto statisticsIter = find_if(begin(lastFrame.statistics), end(lastFrame.statistics), [&block] (const ProfilerBlockStatistics& statistics) { return statistics.id == block.id; });
+			if (statisticsIter == end(lastFrame.statistics))
+			{
+				lastFrame.statistics.emplace_back(block.id, "", 0, duration, 1);
+			}
+			else
+			{
+				statisticsIter->duration += duration;
+				++statisticsIter->hitCount;
+			}
+		}
+		lastFrame.latency = frameNumber - frame.frameNumber;
+		frame.pending = false;
+		return true;
+	}
+}
+
+
+void GPUProfilerInit()
+{
+	supported = GLEW_ARB_timer_query || GLEW_VERSION_3_3;
+	if (!supported)
+		printf("Timer queries aren't supported, the GPU won't be profiled.\n");
+}
+
+
+void GPUProfilerShutdown()
+{
+	for (auto& frame : frames)
+	{
+		if (!frame.queries.empty())
+			glDeleteQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+		frame = PendingFrame {};
+	}
+	currentFrame = nullptr;
+}
+
+
+void GPUProfilerBeginFrame()
+{
+	if (!supported)
+		return;
+
+	++frameNumber;
+
+	// read back the frames that the gpu has finished, oldest first, without waiting for any that it hasn't
+	for (int age = frameLatency; age > 0; --age)
+	{
+		auto& frame = frames[(frameNumber - age + frameLatency) % frameLatency];
+		if (frame.pending && !ReadBackFrame(frame))
+			break;
+	}
+
+	// the oldest frame is dropped if the gpu still hasn't finished it
+	currentFrame = &frames[frameNumber % frameLatency];
+	currentFrame->queryCount = 0;
+	currentFrame->blocks.clear();
+	currentFrame->frameNumber = frameNumber;
+	currentFrame->pending = true;
+	glGetInteger64v(GL_TIMESTAMP, &currentFrame->startTime);
+
+	assert(openBlocks.empty());
+	frameBlock = GPUProfilerBeginBlock("gpu_frame");
+}
+
+
+void GPUProfilerEndFrame()
+{
+	if (!currentFrame)
+		return;
+
+	GPUProfilerEndBlock(frameBlock);
+	assert(openBlocks.empty());
+	currentFrame = nullptr;
+}
+
+
+const GPUProfilerFrame& GPUProfilerGetLastFrame()
+{
+	return lastFrame;
+}
+
+
+int GPUProfilerBeginBlock(const char* id)
+{
+	if (!currentFrame)
+		return -1;
+
+	const int block = static_cast<int>(currentFrame->blocks.size());
+	const int depth = static_cast<int>(openBlocks.size());
+	currentFrame->blocks.push_back(PendingBlock { id, IssueTimestamp(*currentFrame), -1, depth });
+	openBlocks.push_back(block);
+	return block;
+}
+
+
+void GPUProfilerEndBlock(int block)
+{
+	if (!currentFrame || (block < 0))
+		return;
+
+	assert(!openBlocks.empty() && (openBlocks.back() == block));
+	currentFrame->blocks[block].endQuery = IssueTimestamp(*currentFrame);
+	openBlocks.pop_back();
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+
+#include "profiler.h"
+
+
+// Times blocks of GL commands on the GPU with timestamp queries, so that the GPU's share of the frame shows up next to
+// the CPU's. The queries are read back a few frames later, once the GPU has finished with them, so reading them never
+// waits for the GPU. Timestamps are used rather than GL_TIME_ELAPSED queries because those can't be nested.
+
+#define GPU_PROFILER_TIMER_BEGIN(ID) GPUProfilerBlock gpuTimer##ID(#ID)
+
+#define GPU_PROFILER_TIMER_END(ID) gpuTimer##ID.end()
+
+
+void GPUProfilerInit();
+void GPUProfilerShutdown();
+
+// the whole frame is timed as the "gpu_frame" block, begun once the cpu profiler has begun its frame
+void GPUProfilerBeginFrame();
+void GPUProfilerEndFrame();
+
+
+struct GPUProfileTiming
+{
+	const char* id;
+	ProfilerDurationUnit begin; // since the frame began on the cpu, so that it lines up with the cpu's events
+	ProfilerDurationUnit duration;
+	int depth;
+};
+
+struct GPUProfilerFrame
+{
+	std::vector<GPUProfileTiming> timings; // in the order the blocks began, the first is the whole frame
+	ProfilerFrameStatistics statistics; // the totals of each block, the first is the whole frame
+	int latency { 0 }; // how many frames ago it was drawn
+};
+
+// the latest frame to be read back, empty if the timer queries aren't supported
+const GPUProfilerFrame& GPUProfilerGetLastFrame();
+
+
+int GPUProfilerBeginBlock(const char* id);
+void GPUProfilerEndBlock(int block);
+
+struct GPUProfilerBlock
+{
+	explicit GPUProfilerBlock(const char* id)
+		: block { GPUProfilerBeginBlock(id) }
+	{
+	}
+
+	~GPUProfilerBlock()
+	{
+		end();
+	}
+
+	void end()
+	{
+		GPUProfilerEndBlock(block);
+		block = -1;
+	}
+
+	int block;
+};
@@ -0,0 +1,198 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ai.h"
+#include "game.h"
+#include "math_helpers.h"
+#include "physics.h"
+#include "player.h"
+#include "profiler.h"
+#include "recording.h"
+#include "scope_exit.h"
+#include "tweakables.h"
+#include "world.h"
+#include "world_statistics.h"
+
+using namespace std;
+using namespace std::chrono;
+
+
+// Steps a world as fast as possible without a window, driven by the scripted pilot or by the player inputs recorded
+// by an earlier run, and reports how many ticks per second the simulation manages.
+
+namespace
+{
+	struct HeadlessOptions
+	{
+		int ticks { 3600 };
+		uint64_t seed { 2 };
+		float deltaTime { 1.0f / 60.0f };
+		bool untilGameOver { false };
+		bool summary { false };
+		const char* replayFilename { nullptr };
+		const char* recordFilename { nullptr };
+	};
+
+	void PrintUsage()
+	{
+		printf("usage: apollo_headless [options]\n");
+		printf("  --ticks N           number of ticks to step (default 3600)\n");
+		printf("  --seed N            random seed of the world (default 2)\n");
+		printf("  --dt SECONDS        fixed time step (default 1/60)\n");
+		printf("  --until-game-over   stop early once every alien is dead\n");
+		printf("  --replay FILE       play the player inputs recorded in FILE instead of the scripted pilot\n");
+		printf("  --record FILE       save the player input of every tick to FILE\n");
+		printf("  --set NAME=VALUE    set a bool, int or float tweakable, eg. --set AI.LevelOfDetail.NearDistance=200\n");
+		printf("  --summary           print the results as a single line for other tools to parse\n");
+		printf("the AI time budget, AI.UpdateBudgetMicroseconds, is off by default, it is wall clock based and runs with it set don't replay identically\n");
+	}
+
+	bool ParseOptions(int argc, char** argv, HeadlessOptions& options)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const char* arg = argv[i];
+			const bool hasValue = (i + 1 < argc);
+			if ((strcmp(arg, "--ticks") == 0) && hasValue)
+			{
+				options.ticks = atoi(argv[++i]);
+			}
+			else if ((strcmp(arg, "--seed") == 0) && hasValue)
+			{
+				options.seed = strtoull(argv[++i], nullptr, 10);
+			}
+			else if ((strcmp(arg, "--dt") == 0) && hasValue)
+			{
+				options.deltaTime = strtof(argv[++i], nullptr);
+			}
+			else if (strcmp(arg, "--until-game-over") == 0)
+			{
+				options.untilGameOver = true;
+			}
+			else if (strcmp(arg, "--summary") == 0)
+			{
+				options.summary = true;
+			}
+			else if ((strcmp(arg, "--replay") == 0) && hasValue)
+			{
+				options.replayFilename = argv[++i];
+			}
+			else if ((strcmp(arg, "--record") == 0) && hasValue)
+			{
+				options.recordFilename = argv[++i];
+			}
+			else if ((strcmp(arg, "--set") == 0) && hasValue)
+			{
+				const string assignment = argv[++i];
+				const auto equals = assignment.find('=');
+				if ((equals == string::npos) || !Tweakables::GetInstance().SetFromString(assignment.substr(0, equals).c_str(), assignment.substr(equals + 1).c_str()))
+				{
+					printf("Unable to set tweakable: %s\n", assignment.c_str());
+					return false;
+				}
+			}
+			else
+			{
+				return false;
+			}
+		}
+		return (options.ticks > 0) && (options.deltaTime > 0.0f);
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	HeadlessOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	vector<PlayerInput> playerInputs;
+	if (options.replayFilename)
+	{
+		if (!LoadPlayerInputs(options.replayFilename, playerInputs))
+		{
+			printf("Unable to load player inputs from %s\n", options.replayFilename);
+			return 1;
+		}
+		options.ticks = min(options.ticks, static_cast<int>(playerInputs.size()));
+	}
+
+	ProfilerInit();
+	auto profilerQuiter = make_scope_exit(ProfilerShutdown);
+
+	// the world is too large for the stack
+	auto world = make_unique<World>();
+	SeedRandom(world->random, options.seed);
+
+	InitPhysics(*world);
+	InitAI(*world);
+	InitWorld(*world);
+
+	Time time;
+	int tick = 0;
+	int gameOverTick = -1;
+	const auto startTime = high_resolution_clock::now();
+
+	for (; tick < options.ticks; ++tick)
+	{
+		PROFILER_BEGIN_FRAME();
+
+		// reseed every tick the same way as the game does, so that a recording of either plays back the same
+		const uint64_t frameSeed = GetRandomUint64(world->random);
+		SeedRandom(world->random, frameSeed);
+
+		time.deltaTime = options.deltaTime;
+		time.elapsedTime += options.deltaTime;
+
+		const auto playerInput = options.replayFilename ? playerInputs[tick] : GetScriptedPlayerInput(*world, time);
+		if (options.recordFilename && !options.replayFilename)
+		{
+			playerInputs.push_back(playerInput);
+		}
+
+		ApplyPlayerInput(*world, time, playerInput);
+		UpdateWorld(*world, time);
+
+		if ((gameOverTick < 0) && IsGameOver(*world))
+		{
+			gameOverTick = tick;
+			if (options.untilGameOver)
+			{
+				++tick;
+				break;
+			}
+		}
+	}
+
+	const double seconds = duration_cast<duration<double>>(high_resolution_clock::now() - startTime).count();
+
+	if (options.summary)
+	{
+		printf("summary ticks=%d seconds=%.6f score=%d liveAliens=%d spawnedAliens=%zu gameOverTick=%d\n", tick, seconds, world->playerScore, GetLiveAlienCount(*world), world->aliens.size(), gameOverTick);
+	}
+	else
+	{
+		printf("ticks %d in %.3fs, %.1f ticks per second, %.3fms per tick\n", tick, seconds, tick / seconds, 1000.0 * seconds / tick);
+		printf("score %d, live aliens %d, spawned aliens %zu, game over at tick %d\n", world->playerScore, GetLiveAlienCount(*world), world->aliens.size(), gameOverTick);
+	}
+
+	if (options.recordFilename)
+	{
+		if (!SavePlayerInputs(options.recordFilename, playerInputs))
+		{
+			printf("Unable to save player inputs to %s\n", options.recordFilename);
+			return 1;
+		}
+	}
+
+	return 0;
+}
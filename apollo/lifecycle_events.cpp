@@ -0,0 +1,39 @@
+#include "lifecycle_events.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "profiler.h"
+#include "world.h"
+
+using namespace std;
+
+
+void SubscribeToLifecycleEvents(World& world, LifecycleEventHandler handler)
+{
+	auto& handlers = world.lifecycleEvents.handlers;
+	assert(find(begin(handlers), end(handlers), handler) == end(handlers));
+	handlers.push_back(handler);
+}
+
+
+void PublishLifecycleEvent(World& world, LifecycleEventType type, ObjectId objectId, CollisionLayer collisionLayer)
+{
+	world.lifecycleEvents.queue.push_back(LifecycleEvent { type, objectId, collisionLayer });
+}
+
+
+void DispatchLifecycleEvents(World& world)
+{
+	PROFILER_TIMER_FUNCTION();
+
+	auto& lifecycleEvents = world.lifecycleEvents;
+	lifecycleEvents.dispatching.clear();
+	swap(lifecycleEvents.dispatching, lifecycleEvents.queue);
+
+	for (const auto& lifecycleEvent : lifecycleEvents.dispatching)
+	{
+		for (auto handler : lifecycleEvents.handlers)
+			handler(world, lifecycleEvent);
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+
+#include "game.h"
+#include "physics.h"
+
+struct World;
+
+
+// Spawning and killing game objects publish lifecycle events. The events of a frame are queued and dispatched together
+// to every subscriber by DispatchLifecycleEvents, so systems that care about deaths and spawns don't have to poll for them.
+enum class LifecycleEventType { Spawned, Killed };
+
+struct LifecycleEvent
+{
+	LifecycleEventType type;
+	ObjectId objectId;
+	CollisionLayer collisionLayer; // the layer the object was on when the event was published
+};
+
+using LifecycleEventHandler = void (*)(World& world, const LifecycleEvent& lifecycleEvent);
+
+struct LifecycleEvents
+{
+	std::vector<LifecycleEvent> queue; // the events waiting for the next dispatch
+	std::vector<LifecycleEventHandler> handlers;
+	std::vector<LifecycleEvent> dispatching;
+};
+
+void SubscribeToLifecycleEvents(World& world, LifecycleEventHandler handler);
+
+void PublishLifecycleEvent(World& world, LifecycleEventType type, ObjectId objectId, CollisionLayer collisionLayer);
+
+// events published by the subscribers while dispatching are queued for the next dispatch
+void DispatchLifecycleEvents(World& world);
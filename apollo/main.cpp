@@ -5,7 +5,11 @@
 #include <memory>
 #include <tuple>
 #include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
 #include <string>
+#include <thread>
 
 #include "GL/glew.h"
 #include "SDL.h"
@@ -18,15 +22,19 @@
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 
+#include "ai.h"
 #include "game.h"
 #include "profiler.h"
 #include "scope_exit.h"
 #include "gl_helpers.h"
+#include "gpu_profiler.h"
 #include "math_helpers.h"
 #include "sprite.h"
 #include "debug_draw.h"
 #include "physics.h"
 #include "player.h"
+#include "render_queue.h"
+#include "render_snapshot.h"
 #include "rendering.h"
 #include "tweakables.h"
 #include "world.h"
@@ -60,12 +68,202 @@ void ReadPlayerInputFromJoystick(SDL_Joystick& joystick)
 	playerInput.firing = (joystickRightTrigger > -0.5f);
 }
 
+
+// the mouse wheel and the +/- keys zoom the view in steps, the right mouse button drags it and home resets it
+CameraView cameraView;
+
+void ZoomCameraView(float steps)
+{
+	const float zoomStep = 1.25f;
+	cameraView.zoom = std::clamp(cameraView.zoom * powf(zoomStep, steps), 0.125f, 8.0f);
+}
+
+
+// what the main thread passes to the simulation for the frame it is about to step
+struct SimulationCommand
+{
+	PlayerInput playerInput;
+	CameraView cameraView;
+	int replayStep { 0 }; // -1 or 1 to step backwards or forwards through the recording
+};
+
+// Steps the world on a thread of its own, a frame ahead of the rendering. The main thread hands it the command for the
+// next frame, draws the snapshot of the last one while the world is stepped, and then waits for the new snapshot. The
+// frame takes as long as the slower of the two rather than both. The world, the recording and the tweakables are only
+// touched by the main thread while the simulation is waiting for its next command.
+class SimulationThread
+{
+public:
+	SimulationThread(World& world, Recording& recording)
+		: m_world(world)
+		, m_recording(recording)
+		, m_startTime(high_resolution_clock::now())
+		, m_lastTime(m_startTime)
+		, m_thread([this] () { Run(); })
+	{
+	}
+
+	SimulationThread(const SimulationThread&) = delete;
+	SimulationThread& operator=(const SimulationThread&) = delete;
+
+	~SimulationThread()
+	{
+		{
+			lock_guard<mutex> lock(m_mutex);
+			m_quit = true;
+		}
+		m_condition.notify_all();
+		m_thread.join();
+	}
+
+	void BeginFrame(const SimulationCommand& command)
+	{
+		{
+			lock_guard<mutex> lock(m_mutex);
+			assert(!m_frameRequested);
+			m_command = command;
+			m_frameRequested = true;
+		}
+		m_condition.notify_all();
+	}
+
+	// waits for the frame started by BeginFrame, its snapshot is left alone until the end of the next frame
+	const RenderSnapshot& EndFrame()
+	{
+		unique_lock<mutex> lock(m_mutex);
+		m_condition.wait(lock, [this] () { return !m_frameRequested; });
+		m_publishedSnapshot = 1 - m_publishedSnapshot;
+		return m_snapshots[m_publishedSnapshot];
+	}
+
+private:
+	enum class GameUpdateMode { Paused, Play, Replay };
+
+	void Run()
+	{
+		for (;;)
+		{
+			SimulationCommand command;
+			{
+				unique_lock<mutex> lock(m_mutex);
+				m_condition.wait(lock, [this] () { return m_frameRequested || m_quit; });
+				if (m_quit)
+					return;
+				command = m_command;
+			}
+
+			StepFrame(command, m_snapshots[1 - m_publishedSnapshot]);
+
+			{
+				lock_guard<mutex> lock(m_mutex);
+				m_frameRequested = false;
+			}
+			m_condition.notify_all();
+		}
+	}
+
+	void StepFrame(const SimulationCommand& command, RenderSnapshot& snapshot)
+	{
+		PROFILER_BEGIN_FRAME();
+		{
+			PROFILER_TIMER_BEGIN(simulation_frame);
+
+			if (command.replayStep < 0)
+			{
+				m_currentSnapshotIndex = std::max(m_currentSnapshotIndex - 1, 0);
+				m_updateMode = GameUpdateMode::Replay;
+			}
+			else if (command.replayStep > 0)
+			{
+				if (m_currentSnapshotIndex == GetSnapshotCount(m_recording) - 1)
+				{
+					m_updateMode = GameUpdateMode::Play;
+				}
+				else
+				{
+					m_currentSnapshotIndex = std::min(m_currentSnapshotIndex + 1, GetSnapshotCount(m_recording));
+					m_updateMode = GameUpdateMode::Replay;
+				}
+			}
+
+			Time time;
+			uint64_t frameSeed { 0 };
+			PlayerInput playerInput = command.playerInput;
+
+			switch (m_updateMode)
+			{
+			case GameUpdateMode::Paused:
+				break;
+
+			case GameUpdateMode::Play:
+				{
+					frameSeed = GetRandomUint64(m_world.random);
+					SeedRandom(m_world.random, frameSeed);
+
+					auto currentTime = high_resolution_clock::now();
+					time.elapsedTime = duration_cast<duration<float>>(currentTime - m_startTime).count();
+					time.deltaTime = std::min(duration_cast<duration<float>>(currentTime - m_lastTime).count(), 0.1f); // cap deltaTime to 0.1s
+					m_lastTime = currentTime;
+				}
+				break;
+
+			case GameUpdateMode::Replay:
+				ReplaySnapshot(m_recording, m_currentSnapshotIndex, m_world, time, frameSeed, playerInput);
+				SeedRandom(m_world.random, frameSeed);
+				break;
+			};
+
+			if (m_updateMode != GameUpdateMode::Paused)
+			{
+				ApplyPlayerInput(m_world, time, playerInput);
+				UpdateWorld(m_world, time);
+			}
+
+			if (m_updateMode == GameUpdateMode::Play)
+			{
+				m_currentSnapshotIndex = CreateSnapshot(m_recording, m_world, time, frameSeed, playerInput);
+			}
+			ValidateSnapshot(m_recording, m_currentSnapshotIndex, m_world, time, frameSeed);
+
+			CaptureRenderSnapshot(m_world, time, command.cameraView, snapshot);
+
+			PROFILER_TIMER_END(simulation_frame);
+		}
+		snapshot.profileEvents = profileEvents;
+	}
+
+	World& m_world;
+	Recording& m_recording;
+
+	// only used by the simulation thread
+	GameUpdateMode m_updateMode { GameUpdateMode::Play };
+	int m_currentSnapshotIndex { 0 };
+	high_resolution_clock::time_point m_startTime;
+	high_resolution_clock::time_point m_lastTime;
+
+	mutex m_mutex;
+	condition_variable m_condition;
+	SimulationCommand m_command;
+	bool m_frameRequested { false };
+	bool m_quit { false };
+
+	RenderSnapshot m_snapshots[2];
+	int m_publishedSnapshot { 0 };
+
+	// started last, once everything it uses has been constructed
+	thread m_thread;
+};
+
+
 int main(int /*argc*/, char** /*argv*/)
 {
 	ProfilerInit();
 	auto profilerQuiter = make_scope_exit(ProfilerShutdown);
 
-	SeedRandom(2);
+	// the main loop plays a single world, recording a snapshot of every frame so that it can be replayed
+	World world;
+	Recording recording;
+	SeedRandom(world.random, 2);
 
 	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_JOYSTICK) != 0)
 	{
@@ -124,37 +322,47 @@ int main(int /*argc*/, char** /*argv*/)
 	ImGui_ImplSdl_Init(window.get());
 	auto imguiSDLCleanup = make_scope_exit(ImGui_ImplSdl_Shutdown);
 
-	CreateGameObjectMetaData();
-
 	if (!LoadResources())
 	{
 		return 1;
 	}
+	auto resourcesCleanup = make_scope_exit(UnloadResources);
 
-	DebugDrawInit();
+	DebugDrawInit(GetSpriteAtlas());
 	auto debugDrawCleanup = make_scope_exit([] () { DebugDrawShutdown(); });
 
+	GPUProfilerInit();
+	auto gpuProfilerCleanup = make_scope_exit(GPUProfilerShutdown);
+
 	bool renderDebugUI = false;
 	bool renderProfilerUI = true;
 	ProfilerRenderingMode renderProfilerMode = ProfilerRenderingMode::FrameTotals;
 
-	InitPhysics();
-	InitWorld();
+	world.camera.viewSize = Vector2 { windowWidth, windowHeight };
 
-	auto startTime = high_resolution_clock::now();
-	auto lastTime = startTime;
+	InitPhysics(world);
+	InitAI(world);
+	InitWorld(world);
 
-	enum class GameUpdateMode { Paused, Play, Replay };
-	GameUpdateMode updateMode = GameUpdateMode::Play;
-	int currentSnapshotIndex = 0;
+	SimulationThread simulation(world, recording);
+
+	// step the first frame up front, so that there is always a snapshot to draw
+	simulation.BeginFrame(SimulationCommand { playerInput, cameraView });
+	const RenderSnapshot* snapshot = &simulation.EndFrame();
 
 	for (;;)
 	{
 		PROFILER_BEGIN_FRAME();
 		PROFILER_TIMER_BEGIN(main_loop);
 
+		// last frame's fontstash and ImGui drawing left the gl state unknown
+		GLStateCacheBeginFrame();
+		GPUProfilerBeginFrame();
+
 		ImGui_ImplSdl_NewFrame(window.get());
 
+		SimulationCommand command;
+
 		SDL_Event event;
 		while (SDL_PollEvent(&event))
 		{
@@ -178,89 +386,80 @@ int main(int /*argc*/, char** /*argv*/)
 					}
 					break;
 				case SDLK_LEFT:
-					currentSnapshotIndex = std::max(currentSnapshotIndex - 1, 0);
-					updateMode = GameUpdateMode::Replay;
+					command.replayStep = -1;
 					break;
 				case SDLK_RIGHT:
-					if (currentSnapshotIndex == GetSnapshotCount() - 1)
-					{
-						updateMode = GameUpdateMode::Play;
-					}
-					else
-					{
-						currentSnapshotIndex = std::min(currentSnapshotIndex + 1, GetSnapshotCount());
-						updateMode = GameUpdateMode::Replay;
-					}
+					command.replayStep = 1;
+					break;
+				case SDLK_EQUALS:
+				case SDLK_KP_PLUS:
+					ZoomCameraView(1.0f);
+					break;
+				case SDLK_MINUS:
+				case SDLK_KP_MINUS:
+					ZoomCameraView(-1.0f);
+					break;
+				case SDLK_HOME:
+					cameraView = CameraView {};
 					break;
 				}
 				break;
+			case SDL_MOUSEWHEEL:
+				if (!ImGui::GetIO().WantCaptureMouse)
+					ZoomCameraView(static_cast<float>(event.wheel.y));
+				break;
+			case SDL_MOUSEMOTION:
+				if ((event.motion.state & SDL_BUTTON_RMASK) && !ImGui::GetIO().WantCaptureMouse)
+				{
+					// the view is a world unit per pixel before it is zoomed, and the window's y axis points down
+					cameraView.pan += Vector2 { -static_cast<float>(event.motion.xrel), static_cast<float>(event.motion.yrel) } / cameraView.zoom;
+				}
+				break;
 			}
 			ImGui_ImplSdl_ProcessEvent(&event);
 		}
 
-
-		Time time;
-		uint64_t frameSeed { 0 };
-
-		switch (updateMode)
+		if (joystick)
 		{
-		case GameUpdateMode::Paused:
-			break;
-
-		case GameUpdateMode::Play:
-			{
-				frameSeed = GetRandomUint64();
-				SeedRandom(frameSeed);
-
-				auto currentTime = high_resolution_clock::now();
-				time.elapsedTime = duration_cast<duration<float>>(currentTime - startTime).count();
-				time.deltaTime = std::min(duration_cast<duration<float>>(currentTime - lastTime).count(), 0.1f); // cap deltaTime to 0.1s
-				lastTime = currentTime;
-
-				if (joystick)
-				{
-					ReadPlayerInputFromJoystick(*joystick);
-				}
-			}
-			break;
+			ReadPlayerInputFromJoystick(*joystick);
+		}
+		command.playerInput = playerInput;
+		command.cameraView = cameraView;
 
-		case GameUpdateMode::Replay:
-			ReplaySnapshot(currentSnapshotIndex, time, frameSeed, playerInput);
-			SeedRandom(frameSeed);
-			break;
-		};
+		// the world steps the next frame while this one is drawn
+		simulation.BeginFrame(command);
 
-		if (updateMode != GameUpdateMode::Paused)
+		RenderWorld(*snapshot, windowWidth, windowHeight);
+		RenderUI(*snapshot, windowWidth, windowHeight);
+		DebugDrawRender(GetRenderQueue(), snapshot->camera, snapshot->time, windowWidth, windowHeight);
 		{
-			ApplyPlayerInput(time, playerInput);
-			UpdateWorld(time);
+			GPU_PROFILER_TIMER_BEGIN(render_queue);
+			ExecuteRenderQueue(GetRenderQueue());
 		}
 
-		RenderWorld(time, windowWidth, windowHeight);
-		RenderUI(time, windowWidth, windowHeight);
+		snapshot = &simulation.EndFrame();
+		ProfilerAddThreadEvents(snapshot->profileEvents);
 		PROFILER_TIMER_END(main_loop);
 
-		DebugDrawRender(time, windowWidth, windowHeight);
-
-		if (updateMode == GameUpdateMode::Play)
-		{
-			currentSnapshotIndex = CreateSnapshot(time, frameSeed, playerInput);
-		}
-		ValidateSnapshot(currentSnapshotIndex, time, frameSeed);
-
+		// the simulation is waiting for its next command, so the tweakables can be changed
+		// the profiler's text and graph are drawn by the next frame's queue
 		if (renderProfilerUI)
 		{
-			RenderProfiler(time, windowWidth, windowHeight, renderProfilerMode);
+			RenderProfiler(*snapshot, windowWidth, windowHeight, renderProfilerMode);
 		}
 
 		if (renderDebugUI)
 		{
-			RenderDebugUI(time, windowWidth, windowHeight);
+			RenderDebugUI(snapshot->time, windowWidth, windowHeight);
+		}
+		{
+			GPU_PROFILER_TIMER_BEGIN(imgui);
+			ImGui::Render();
 		}
-		ImGui::Render();
 
 		CheckOpenGLErrors();
 
+		GPUProfilerEndFrame();
 		SDL_GL_SwapWindow(window.get());
 	}
 
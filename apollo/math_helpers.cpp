@@ -4,10 +4,6 @@
 
 using namespace std;
 
-static mt19937_64 randomEngine;
-static uniform_real_distribution<float> randomFloat01 { 0.0f, 1.0f };
-static uniform_int_distribution<uint64_t> randomUint64;
-
 Matrix4x4 CalculateObjectTransform(const Vector3& position, const Vector3& facing)
 {
 	auto y = facing;
@@ -26,30 +22,30 @@ Matrix4x4 CalculateObjectTransform(const Vector2& position, const Vector2& facin
 	return transform;
 }
 
-void SeedRandom(uint64_t seed)
+void SeedRandom(RandomGenerator& random, uint64_t seed)
 {
-	randomEngine.seed(seed);
+	random.engine.seed(seed);
 }
 
-float GetRandomFloat01()
+float GetRandomFloat01(RandomGenerator& random)
 {
-	return randomFloat01(randomEngine);
+	return random.float01(random.engine);
 }
 
-uint64_t GetRandomUint64()
+uint64_t GetRandomUint64(RandomGenerator& random)
 {
-	return randomUint64(randomEngine);
+	return random.uint64(random.engine);
 }
 
-Vector2 GetRandomVectorOnCircle()
+Vector2 GetRandomVectorOnCircle(RandomGenerator& random)
 {
-	float angle = randomFloat01(randomEngine) * TWO_PI;
+	float angle = random.float01(random.engine) * TWO_PI;
 	return Vector2 { cos(angle), sin(angle) };
 }
 
-Vector2 GetRandomVectorInBox(const Vector2& min, const Vector2& max)
+Vector2 GetRandomVectorInBox(RandomGenerator& random, const Vector2& min, const Vector2& max)
 {
-	float x = randomFloat01(randomEngine) * (max.x - min.x) + min.x;
-	float y = randomFloat01(randomEngine) * (max.y - min.y) + min.y;
+	float x = random.float01(random.engine) * (max.x - min.x) + min.x;
+	float y = random.float01(random.engine) * (max.y - min.y) + min.y;
 	return Vector2(x, y);
 }
@@ -72,9 +72,17 @@ Matrix4x4 CalculateObjectTransform(const Vector3& position, const Vector3& facin
 Matrix4x4 CalculateObjectTransform(const Vector2& position, const Vector2& facing);
 
 
-void SeedRandom(uint64_t seed);
-float GetRandomFloat01();
-uint64_t GetRandomUint64();
-Vector2 GetRandomVectorOnCircle();
-Vector2 GetRandomVectorInBox(const Vector2& min, const Vector2& max);
+// Each simulation draws from its own generator, so independent worlds don't disturb each other's sequences.
+struct RandomGenerator
+{
+	std::mt19937_64 engine;
+	std::uniform_real_distribution<float> float01 { 0.0f, 1.0f };
+	std::uniform_int_distribution<uint64_t> uint64;
+};
+
+void SeedRandom(RandomGenerator& random, uint64_t seed);
+float GetRandomFloat01(RandomGenerator& random);
+uint64_t GetRandomUint64(RandomGenerator& random);
+Vector2 GetRandomVectorOnCircle(RandomGenerator& random);
+Vector2 GetRandomVectorInBox(RandomGenerator& random, const Vector2& min, const Vector2& max);
 
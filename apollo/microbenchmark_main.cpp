@@ -0,0 +1,283 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ai.h"
+#include "game.h"
+#include "game_object.h"
+#include "math_helpers.h"
+#include "physics.h"
+#include "player.h"
+#include "profiler.h"
+#include "recording.h"
+#include "scope_exit.h"
+#include "tweakables.h"
+#include "world.h"
+
+using namespace std;
+using namespace std::chrono;
+
+
+// Times the leaf kernels of the simulation in isolation. Each kernel is called in batches large enough to be timed
+// reliably, after a few warmup batches, and the time per call is summarised over many batches. The inputs are drawn
+// from a world built from a fixed seed, so the results can be compared before and after a change.
+
+namespace
+{
+	struct MicrobenchmarkOptions
+	{
+		int warmupRepetitions { 5 };
+		int repetitions { 30 };
+		double minRepetitionMilliseconds { 2.0 };
+		const char* filter { nullptr };
+		const char* csvFilename { nullptr };
+	};
+
+	struct MicrobenchmarkStatistics
+	{
+		const char* name;
+		int iterations; // calls per repetition
+		double minimum; // nanoseconds per call
+		double median;
+		double mean;
+		double standardDeviation;
+		double maximum;
+	};
+
+	// the results of the kernels are accumulated here so that the calls can't be optimised away
+	volatile uint64_t microbenchmarkSink;
+
+	uint64_t ToSinkValue(bool value) { return value ? 1 : 0; }
+	uint64_t ToSinkValue(size_t value) { return value; }
+	uint64_t ToSinkValue(uint32_t value) { return value; }
+	uint64_t ToSinkValue(float value) { return static_cast<uint64_t>(value != 0.0f); }
+	uint64_t ToSinkValue(const Vector2& value) { return ToSinkValue(value.x + value.y); }
+
+
+	// function(i) is the kernel called with the index of the call, for cycling through the inputs
+	template <typename Function>
+	MicrobenchmarkStatistics RunMicrobenchmark(const MicrobenchmarkOptions& options, const char* name, Function&& function)
+	{
+		int iteration = 0;
+		auto runRepetition = [&function, &iteration] (int iterations)
+		{
+			// the kernels may be instrumented, don't let the profile events pile up between frames
+			PROFILER_BEGIN_FRAME();
+			uint64_t sink = 0;
+			const auto startTime = high_resolution_clock::now();
+			for (int i = 0; i < iterations; ++i)
+				sink += ToSinkValue(function(iteration++));
+			const auto endTime = high_resolution_clock::now();
+			microbenchmarkSink = microbenchmarkSink + sink;
+			return duration_cast<duration<double, nano>>(endTime - startTime).count();
+		};
+
+		// double the batch size until a batch takes long enough to time reliably
+		int iterations = 1;
+		while ((runRepetition(iterations) < 1.0e6 * options.minRepetitionMilliseconds) && (iterations < (1 << 24)))
+			iterations *= 2;
+
+		for (int repetition = 0; repetition < options.warmupRepetitions; ++repetition)
+			runRepetition(iterations);
+
+		vector<double> samples;
+		samples.reserve(options.repetitions);
+		for (int repetition = 0; repetition < options.repetitions; ++repetition)
+			samples.push_back(runRepetition(iterations) / iterations);
+		sort(begin(samples), end(samples));
+
+		MicrobenchmarkStatistics statistics { name, iterations, samples.front(), 0.0, 0.0, 0.0, samples.back() };
+		const size_t middle = samples.size() / 2;
+		statistics.median = (samples.size() % 2) ? samples[middle] : 0.5 * (samples[middle - 1] + samples[middle]);
+		for (const auto sample : samples)
+			statistics.mean += sample;
+		statistics.mean /= samples.size();
+		for (const auto sample : samples)
+			statistics.standardDeviation += (sample - statistics.mean) * (sample - statistics.mean);
+		statistics.standardDeviation = sqrt(statistics.standardDeviation / samples.size());
+		return statistics;
+	}
+
+
+	// a world of a thousand aliens stepped for a second, with every chunk active
+	unique_ptr<World> CreateMicrobenchmarkWorld()
+	{
+		auto& tweakables = Tweakables::GetInstance();
+		tweakables.SetInt("World.InitialAlienCount", 1000);
+		tweakables.SetInt("World.SizeMultiplier", 4);
+		tweakables.SetInt("AI.UpdateBudgetMicroseconds", 0);
+
+		auto world = make_unique<World>();
+		SeedRandom(world->random, 1);
+		InitPhysics(*world);
+		InitAI(*world);
+		InitWorld(*world);
+		world->camera.viewSize = world->initialMaxWorld - world->initialMinWorld;
+
+		Time time;
+		const PlayerInput playerInput;
+		for (int tick = 0; tick < 60; ++tick)
+		{
+			PROFILER_BEGIN_FRAME();
+			time.deltaTime = 1.0f / 60.0f;
+			time.elapsedTime += time.deltaTime;
+			ApplyPlayerInput(*world, time, playerInput);
+			UpdateWorld(*world, time);
+		}
+		return world;
+	}
+
+
+	void PrintStatistics(const MicrobenchmarkStatistics& statistics)
+	{
+		const double relativeDeviation = (statistics.mean > 0.0) ? 100.0 * statistics.standardDeviation / statistics.mean : 0.0;
+		printf("%-32s %10d %10.1f %10.1f %10.1f %9.1f%% %10.1f\n", statistics.name, statistics.iterations, statistics.minimum, statistics.median, statistics.mean, relativeDeviation, statistics.maximum);
+	}
+
+	void PrintUsage()
+	{
+		printf("usage: apollo_microbenchmark [options]\n");
+		printf("  --filter TEXT       run only the kernels whose name contains TEXT\n");
+		printf("  --warmup N          untimed repetitions before the timed ones (default 5)\n");
+		printf("  --repetitions N     timed repetitions to summarise (default 30)\n");
+		printf("  --min-time MS       the least time a repetition takes, sets the calls per repetition (default 2)\n");
+		printf("  --csv FILE          also write the results as CSV\n");
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	MicrobenchmarkOptions options;
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		const bool hasValue = (i + 1 < argc);
+		if ((strcmp(arg, "--filter") == 0) && hasValue)
+			options.filter = argv[++i];
+		else if ((strcmp(arg, "--warmup") == 0) && hasValue)
+			options.warmupRepetitions = atoi(argv[++i]);
+		else if ((strcmp(arg, "--repetitions") == 0) && hasValue)
+			options.repetitions = atoi(argv[++i]);
+		else if ((strcmp(arg, "--min-time") == 0) && hasValue)
+			options.minRepetitionMilliseconds = strtod(argv[++i], nullptr);
+		else if ((strcmp(arg, "--csv") == 0) && hasValue)
+			options.csvFilename = argv[++i];
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+	}
+	if ((options.warmupRepetitions < 0) || (options.repetitions <= 0) || (options.minRepetitionMilliseconds <= 0.0))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	ProfilerInit();
+	auto profilerQuiter = make_scope_exit(ProfilerShutdown);
+
+	auto world = CreateMicrobenchmarkWorld();
+
+	// the inputs, a power of two of each so that the kernels cycle through them with a mask
+	constexpr int inputCount = 1024;
+	constexpr int inputMask = inputCount - 1;
+	RandomGenerator random;
+	SeedRandom(random, 1);
+
+	vector<ObjectId> liveObjectIds;
+	for (const auto& alien : world->aliens)
+	{
+		if (alien.isAlive)
+			liveObjectIds.push_back(alien.objectId);
+	}
+	for (const auto& bullet : world->bullets)
+	{
+		if (bullet.isAlive)
+			liveObjectIds.push_back(bullet.objectId);
+	}
+	vector<ObjectId> objectIds(inputCount);
+	for (auto& objectId : objectIds)
+		objectId = liveObjectIds[min(static_cast<size_t>(GetRandomFloat01(random) * liveObjectIds.size()), liveObjectIds.size() - 1)];
+
+	vector<Vector2> positions(inputCount);
+	vector<Vector2> facings(inputCount);
+	vector<Vector2> dimensions(inputCount);
+	vector<Vector2> worldPositions(inputCount);
+	for (int i = 0; i < inputCount; ++i)
+	{
+		positions[i] = GetRandomVectorInBox(random, Vector2 { -64.0f, -64.0f }, Vector2 { 64.0f, 64.0f });
+		facings[i] = GetRandomVectorOnCircle(random);
+		dimensions[i] = GetRandomVectorInBox(random, Vector2 { 2.0f, 2.0f }, Vector2 { 64.0f, 64.0f });
+		worldPositions[i] = GetRandomVectorInBox(random, world->minWorld, world->maxWorld);
+	}
+
+	// alien and player bullet pairs close enough together that about half of them overlap
+	vector<CollisionObject> collisionObjectsA(inputCount);
+	vector<CollisionObject> collisionObjectsB(inputCount);
+	for (int i = 0; i < inputCount; ++i)
+	{
+		auto& objectA = collisionObjectsA[i];
+		objectA.boundingBoxDimensions = Vector2 { 32.0f, 32.0f };
+		objectA.position = Vector2 { 0.0f, 0.0f };
+		objectA.facing = facings[i];
+		objectA.layer = CollisionLayer::Alien;
+		objectA.layerMask = CollisionLayer::Player | CollisionLayer::PlayerBullet;
+
+		auto& objectB = collisionObjectsB[i];
+		objectB.boundingBoxDimensions = Vector2 { 2.0f, 12.0f };
+		objectB.position = 0.5f * positions[i];
+		objectB.facing = facings[(i + 1) & inputMask];
+		objectB.layer = CollisionLayer::PlayerBullet;
+		objectB.layerMask = CollisionLayer::Alien;
+	}
+
+	const World& constWorld = *world;
+	Recording recording;
+	const PlayerInput playerInput;
+
+	vector<MicrobenchmarkStatistics> results;
+	auto run = [&options, &results] (const char* name, auto&& function)
+	{
+		if (options.filter && !strstr(name, options.filter))
+			return;
+		results.push_back(RunMicrobenchmark(options, name, function));
+		PrintStatistics(results.back());
+	};
+
+	printf("nanoseconds per call over %d repetitions after %d warmup repetitions\n", options.repetitions, options.warmupRepetitions);
+	printf("%-32s %10s %10s %10s %10s %10s %10s\n", "kernel", "calls", "min", "median", "mean", "stddev", "max");
+
+	run("CollisionObjectsCollide", [&] (int i) { return CollisionObjectsCollide(collisionObjectsA[i & inputMask], collisionObjectsB[i & inputMask]); });
+	run("GatherBoundingBoxVertices", [&] (int i) { return GatherBoundingBoxVertices(positions[i & inputMask], facings[i & inputMask], dimensions[i & inputMask]).back(); });
+	run("GetRigidBody", [&] (int i) { return GetRigidBody(constWorld, objectIds[i & inputMask]).position; });
+	run("GetCollisionObject", [&] (int i) { return GetCollisionObject(constWorld, objectIds[i & inputMask]).position; });
+	run("GetGameObject", [&] (int i) { return GetGameObject(constWorld, objectIds[i & inputMask]).isAlive; });
+	run("GetAliensInCircle", [&] (int i) { return GetAliensInCircle(constWorld, worldPositions[i & inputMask], 200.0f).size(); });
+	run("CalculateObjectTransform", [&] (int i) { return CalculateObjectTransform(positions[i & inputMask], facings[i & inputMask])[3][0]; });
+	run("GetRandomVectorOnCircle", [&] (int /*i*/) { return GetRandomVectorOnCircle(random); });
+	run("CreateSnapshot", [&] (int i)
+	{
+		// only the latest snapshot is kept, so this includes freeing the one before it
+		recording.snapshots.clear();
+		return static_cast<uint32_t>(CreateSnapshot(recording, constWorld, Time {}, static_cast<uint64_t>(i), playerInput));
+	});
+
+	if (options.csvFilename)
+	{
+		ofstream file(options.csvFilename);
+		file << "kernel,calls,minNs,medianNs,meanNs,standardDeviationNs,maxNs\n";
+		for (const auto& statistics : results)
+			file << statistics.name << ',' << statistics.iterations << ',' << statistics.minimum << ',' << statistics.median << ',' << statistics.mean << ',' << statistics.standardDeviation << ',' << statistics.maximum << '\n';
+	}
+
+	return 0;
+}
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <cfloat>
 
 #include "glm/gtx/rotate_vector.hpp"
 
@@ -6,38 +7,48 @@
 #include "world.h"
 #include "math_helpers.h"
 #include "profiler.h"
+#include "world_chunks.h"
 
 using namespace std;
 
-vector<RigidBody> rigidBodies;
-vector<CollisionObject> collisionObjects;
+const int MAX_RIGID_BODIES = 65536;
+const int MAX_COLLISION_OBJECTS = 65536;
 
-const int MAX_RIGID_BODIES = 1000;
-const int MAX_COLLISION_OBJECTS = 1000;
-
-void InitPhysics()
+void InitPhysics(World& world)
 {
-	rigidBodies.reserve(MAX_RIGID_BODIES);
-	collisionObjects.reserve(MAX_COLLISION_OBJECTS);
+	world.rigidBodies.reserve(MAX_RIGID_BODIES);
+	world.collisionObjects.reserve(MAX_COLLISION_OBJECTS);
 }
 
 
-RigidBody& GetRigidBody(ObjectId objectId)
+const RigidBody& GetRigidBody(const World& world, ObjectId objectId)
 {
 	// we can use a binary search if we can guarantee that elements are never reordered.
+	const auto& rigidBodies = world.rigidBodies;
 	auto rigidBodyIter = lower_bound(begin(rigidBodies), end(rigidBodies), objectId, [] (const auto& rigidBody, auto objectId) { return GetIndex(rigidBody.objectId) < GetIndex(objectId); });
 	assert((rigidBodyIter != end(rigidBodies)) && (GetIndex(rigidBodyIter->objectId) == GetIndex(objectId)));
 	return *rigidBodyIter;
 }
 
-CollisionObject& GetCollisionObject(ObjectId objectId)
+RigidBody& GetRigidBody(World& world, ObjectId objectId)
+{
+	return const_cast<RigidBody&>(GetRigidBody(static_cast<const World&>(world), objectId));
+}
+
+const CollisionObject& GetCollisionObject(const World& world, ObjectId objectId)
 {
 	// we can use a binary search if we can guarantee that elements are never reordered.
+	const auto& collisionObjects = world.collisionObjects;
 	auto collisionObjectIter = lower_bound(begin(collisionObjects), end(collisionObjects), objectId, [] (const auto& collisionObjects, auto objectId) { return GetIndex(collisionObjects.objectId) < GetIndex(objectId); });
 	assert((collisionObjectIter != end(collisionObjects)) && (GetIndex(collisionObjectIter->objectId) == GetIndex(objectId)));
 	return *collisionObjectIter;
 }
 
+CollisionObject& GetCollisionObject(World& world, ObjectId objectId)
+{
+	return const_cast<CollisionObject&>(GetCollisionObject(static_cast<const World&>(world), objectId));
+}
+
 
 vector<Vector2> GatherBoundingBoxVertices(const Vector2& position, const Vector2& facing, const Vector2& dimensions)
 {
@@ -118,26 +129,26 @@ bool AABBContains(const Vector2& aabbMin, const Vector2& aabbMax, const Vector2&
 }
 
 
-bool BoundingBoxCollidesWithWorldEdge(const Vector2& position, const Vector2& facing, const Vector2& dimensions)
+bool BoundingBoxCollidesWithWorldEdge(const World& world, const Vector2& position, const Vector2& facing, const Vector2& dimensions)
 {
 	vector<Vector2> objectVertices = GatherBoundingBoxVertices(position, facing, dimensions);
 	for (const auto& vertex : objectVertices)
 	{
-		if (!AABBContains(minWorld, maxWorld, vertex))
+		if (!AABBContains(world.minWorld, world.maxWorld, vertex))
 			return true;
 	}
 	return false;
 }
 
 
-bool CollisionObjectCollidesWithWorldEdge(const CollisionObject& object)
+bool CollisionObjectCollidesWithWorldEdge(const World& world, const CollisionObject& object)
 {
 	PROFILER_TIMER_FUNCTION();
 
 	vector<Vector2> objectVertices = GatherObjectVertices(object);
 	for (const auto& vertex : objectVertices)
 	{
-		if (!AABBContains(minWorld, maxWorld, vertex))
+		if (!AABBContains(world.minWorld, world.maxWorld, vertex))
 			return true;
 	}
 	return false;
@@ -145,41 +156,56 @@ bool CollisionObjectCollidesWithWorldEdge(const CollisionObject& object)
 
 
 
-RigidBody& AddRigidBody(ObjectId objectId, const Vector2& position, const Vector2& facing)
+RigidBody& AddRigidBody(World& world, ObjectId objectId, const Vector2& position, const Vector2& facing)
 {
-	assert(rigidBodies.size() < MAX_RIGID_BODIES);
-	rigidBodies.push_back(RigidBody { objectId, position, facing });
-	return rigidBodies.back();
+	assert(world.rigidBodies.size() < MAX_RIGID_BODIES);
+	world.rigidBodies.push_back(RigidBody { objectId, position, facing });
+	RigidBody& rigidBody = world.rigidBodies.back();
+	rigidBody.chunkIndex = GetWorldChunkIndex(world.chunks, position);
+	AddToWorldChunk(world.chunks, objectId, rigidBody.chunkIndex);
+	return rigidBody;
 }
 
-CollisionObject& AddCollisionObject(ObjectId objectId, const Vector2& boundingBoxDimensions)
+CollisionObject& AddCollisionObject(World& world, ObjectId objectId, const Vector2& boundingBoxDimensions)
 {
-	assert(collisionObjects.size() < MAX_COLLISION_OBJECTS);
-	collisionObjects.push_back(CollisionObject { objectId, boundingBoxDimensions });
-	CollisionObject& collisionObject = collisionObjects.back();
-	const RigidBody& rigidBody = GetRigidBody(objectId);
+	assert(world.collisionObjects.size() < MAX_COLLISION_OBJECTS);
+	world.collisionObjects.push_back(CollisionObject { objectId, boundingBoxDimensions });
+	CollisionObject& collisionObject = world.collisionObjects.back();
+	const RigidBody& rigidBody = GetRigidBody(world, objectId);
 	collisionObject.position = rigidBody.position;
 	collisionObject.facing = rigidBody.facing;
 	return collisionObject;
 }
 
-void UpdateRigidBodies(const Time& time)
+void UpdateRigidBodies(World& world, const Time& time)
 {
 	PROFILER_TIMER_FUNCTION();
 
-	// physics dynamic update
+	// physics dynamic update, only the objects in the active chunks move
 	float deltaTime = time.deltaTime;
-	for_each(begin(rigidBodies), end(rigidBodies), [deltaTime] (RigidBody& rigidBody)
+	auto& worldChunks = world.chunks;
+	for (const auto objectId : worldChunks.activeObjectIds)
 	{
+		auto& rigidBody = GetRigidBody(world, objectId);
 		rigidBody.position += rigidBody.velocity * deltaTime;
 		rigidBody.facing = glm::normalize(glm::rotate(rigidBody.facing, rigidBody.angularVelocity * deltaTime));
-	});
+
+		uint32_t chunkIndex = GetWorldChunkIndex(worldChunks, rigidBody.position);
+		if (chunkIndex != rigidBody.chunkIndex)
+		{
+			RemoveFromWorldChunk(worldChunks, objectId, rigidBody.chunkIndex);
+			AddToWorldChunk(worldChunks, objectId, chunkIndex);
+			rigidBody.chunkIndex = chunkIndex;
+		}
+	}
 }
 
-void EnsurePlayerIsInsideWorldBounds()
+void EnsurePlayerIsInsideWorldBounds(World& world)
 {
-	auto& playerRB = GetRigidBody(player.objectId);
-	const auto& playerCollision = GetCollisionObject(player.objectId);
+	const Vector2& minWorld = world.minWorld;
+	const Vector2& maxWorld = world.maxWorld;
+	auto& playerRB = GetRigidBody(world, world.player.objectId);
+	const auto& playerCollision = GetCollisionObject(world, world.player.objectId);
 	vector<Vector2> objectVertices = GatherBoundingBoxVertices(playerRB.position, playerRB.facing, playerCollision.boundingBoxDimensions);
 	Vector2 deltaRequired { 0.0f, 0.0f };
 	for (const auto& vertex : objectVertices)
@@ -207,44 +233,125 @@ void EnsurePlayerIsInsideWorldBounds()
 	}
 }
 
-// return all of the objects that have been in a collision
-void UpdateCollision(const Time& /*time*/, vector<pair<ObjectId, ObjectId>>& collidingPairs, vector<ObjectId>& collidingWithWorld)
+namespace
 {
-	PROFILER_TIMER_FUNCTION();
+	// the collision objects of each chunk in the active chunks and the ring of chunks around them
+	struct CollisionChunks
+	{
+		int minX { 0 };
+		int minY { 0 };
+		int width { 0 };
+		int height { 0 };
+		vector<vector<CollisionObject*>> chunks;
+
+		vector<CollisionObject*>& Get(int x, int y) { return chunks[(y - minY) * width + (x - minX)]; }
+	};
 
-	// update collision objects from rigid bodies
-	for_each(begin(collisionObjects), end(collisionObjects), [] (CollisionObject& collisionObject)
+	void GatherCollisionChunks(World& world, CollisionChunks& collisionChunks)
 	{
-		const auto& rigidBody = GetRigidBody(collisionObject.objectId);
-		collisionObject.position = rigidBody.position;
-		collisionObject.facing = rigidBody.facing;
-	});
+		const auto& worldChunks = world.chunks;
+		collisionChunks.minX = max(worldChunks.activeMinX - 1, 0);
+		collisionChunks.minY = max(worldChunks.activeMinY - 1, 0);
+		collisionChunks.width = min(worldChunks.activeMaxX + 1, worldChunks.width - 1) - collisionChunks.minX + 1;
+		collisionChunks.height = min(worldChunks.activeMaxY + 1, worldChunks.height - 1) - collisionChunks.minY + 1;
+		collisionChunks.chunks.resize(max(collisionChunks.width * collisionChunks.height, 0));
+
+		for (int y = 0; y < collisionChunks.height; ++y)
+		{
+			for (int x = 0; x < collisionChunks.width; ++x)
+			{
+				auto& chunkCollisionObjects = collisionChunks.chunks[y * collisionChunks.width + x];
+				chunkCollisionObjects.clear();
+				const auto& chunk = worldChunks.chunks[(collisionChunks.minY + y) * worldChunks.width + collisionChunks.minX + x];
+				for (const auto objectId : chunk.objectIds)
+				{
+					auto& collisionObject = GetCollisionObject(world, objectId);
+					if (collisionObject.layer != CollisionLayer::PendingDestruction)
+						chunkCollisionObjects.push_back(&collisionObject);
+				}
+			}
+		}
+	}
+
+	// a cheap rejection before the separating axis test, a chunk holds many objects that are nowhere near each other,
+	// or that are on layers which never collide, such as the aliens in a flock
+	bool MayCollide(const CollisionObject& objectA, const CollisionObject& objectB)
+	{
+		if (((objectA.layerMask & objectB.layer) == CollisionLayer::None) && ((objectB.layerMask & objectA.layer) == CollisionLayer::None))
+			return false;
+		float radii = 0.5f * (glm::length(objectA.boundingBoxDimensions) + glm::length(objectB.boundingBoxDimensions));
+		Vector2 separation = objectA.position - objectB.position;
+		return glm::dot(separation, separation) <= radii * radii;
+	}
+
+	void CollideCollisionObjects(const vector<CollisionObject*>& objectsA, const vector<CollisionObject*>& objectsB, vector<pair<ObjectId, ObjectId>>& collidingPairs)
+	{
+		for (const auto* collisionObjectA : objectsA)
+		{
+			for (const auto* collisionObjectB : objectsB)
+			{
+				if (MayCollide(*collisionObjectA, *collisionObjectB) && CollisionObjectsCollide(*collisionObjectA, *collisionObjectB))
+					collidingPairs.push_back(make_pair(collisionObjectA->objectId, collisionObjectB->objectId));
+			}
+		}
+	}
+}
+
+// return all of the objects that have been in a collision
+void UpdateCollision(World& world, const Time& /*time*/, vector<pair<ObjectId, ObjectId>>& collidingPairs, vector<ObjectId>& collidingWithWorld)
+{
+	PROFILER_TIMER_FUNCTION();
 
-	// collision tests between every collision object
 	collidingWithWorld.clear();
-	collidingWithWorld.reserve(collisionObjects.size());
 	collidingPairs.clear();
-	collidingPairs.reserve(collisionObjects.size());
 
-	for (int i = 0; i < collisionObjects.size(); ++i)
+	// update collision objects from the rigid bodies that moved, and test them against the world edge
+	const auto& worldChunks = world.chunks;
+	for (const auto objectId : worldChunks.activeObjectIds)
 	{
-		auto& collisionObjectI = collisionObjects[i];
-		if (collisionObjectI.layer == CollisionLayer::PendingDestruction)
+		auto& collisionObject = GetCollisionObject(world, objectId);
+		const auto& rigidBody = GetRigidBody(world, objectId);
+		collisionObject.position = rigidBody.position;
+		collisionObject.facing = rigidBody.facing;
+		if (collisionObject.layer == CollisionLayer::PendingDestruction)
 			continue;
 
-		if (CollisionObjectCollidesWithWorldEdge(collisionObjectI))
+		// bullets that leave the active chunks would be frozen in flight, so they leave the world instead
+		if (CollisionObjectCollidesWithWorldEdge(world, collisionObject) || ((GetType(objectId) == GameObjectType::Bullet) && !IsWorldChunkActive(worldChunks, rigidBody.chunkIndex)))
 		{
-			collidingWithWorld.push_back(collisionObjectI.objectId);
+			collidingWithWorld.push_back(objectId);
 		}
+	}
 
-		for (int j = i + 1; j < collisionObjects.size(); ++j)
+	// collision tests between the objects in each active chunk and those in the same and neighbouring chunks
+	// objects are small compared to a chunk, so anything that overlaps must be in a neighbouring chunk
+	thread_local CollisionChunks collisionChunks;
+	GatherCollisionChunks(world, collisionChunks);
+
+	for (int y = worldChunks.activeMinY; y <= worldChunks.activeMaxY; ++y)
+	{
+		for (int x = worldChunks.activeMinX; x <= worldChunks.activeMaxX; ++x)
 		{
-			auto& collisionObjectJ = collisionObjects[j];
-			if (collisionObjectJ.layer == CollisionLayer::PendingDestruction)
-				continue;
-			if (CollisionObjectsCollide(collisionObjectI, collisionObjectJ))
+			const auto& chunkObjects = collisionChunks.Get(x, y);
+			for (size_t i = 0; i < chunkObjects.size(); ++i)
+			{
+				for (size_t j = i + 1; j < chunkObjects.size(); ++j)
+				{
+					if (MayCollide(*chunkObjects[i], *chunkObjects[j]) && CollisionObjectsCollide(*chunkObjects[i], *chunkObjects[j]))
+						collidingPairs.push_back(make_pair(chunkObjects[i]->objectId, chunkObjects[j]->objectId));
+				}
+			}
+
+			// each pair of active chunks is tested once, from the first chunk of the pair, inactive neighbours from every active chunk
+			for (int ny = max(y - 1, 0); ny <= min(y + 1, worldChunks.height - 1); ++ny)
 			{
-				collidingPairs.push_back(make_pair(collisionObjectI.objectId, collisionObjectJ.objectId));
+				for (int nx = max(x - 1, 0); nx <= min(x + 1, worldChunks.width - 1); ++nx)
+				{
+					const bool isLaterActiveChunk = (ny > y) || ((ny == y) && (nx > x));
+					if (((nx == x) && (ny == y)) || (IsWorldChunkActive(worldChunks, nx, ny) && !isLaterActiveChunk))
+						continue;
+					CollideCollisionObjects(chunkObjects, collisionChunks.Get(nx, ny), collidingPairs);
+				}
 			}
 		}
 	}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cassert>
 #include <utility>
 #include <vector>
 
@@ -28,22 +29,9 @@ struct RigidBody
 	Vector2 facing { 0.0f, 0.0f };
 	Vector2 velocity { 0.0f, 0.0f };
 	float angularVelocity { 0.0f };
+	uint32_t chunkIndex { 0 }; // the world chunk that lists this object
 };
 
-RigidBody& GetRigidBody(ObjectId objectId);
-
-enum class CollisionLayer : uint32_t { None = 0, Player = 1, PlayerBullet = 2, Alien = 4, All = 0xffff, PendingDestruction = 0x80000000 };
-
-inline CollisionLayer operator&(CollisionLayer lhs, CollisionLayer rhs)
-{
-	return static_cast<CollisionLayer>(static_cast<uint32_t>(lhs) & static_cast<uint32_t>(rhs));
-}
-
-inline CollisionLayer operator|(CollisionLayer lhs, CollisionLayer rhs)
-{
-	return static_cast<CollisionLayer>(static_cast<uint32_t>(lhs) | static_cast<uint32_t>(rhs));
-}
-
 struct CollisionObject
 {
 	CollisionObject() = default;
@@ -68,23 +56,27 @@ struct CollisionObject
 };
 
 
-extern std::vector<RigidBody> rigidBodies;
-extern std::vector<CollisionObject> collisionObjects;
+struct World;
 
+void InitPhysics(World& world);
 
-void InitPhysics();
+RigidBody& AddRigidBody(World& world, ObjectId objectId, const Vector2& position, const Vector2& facing);
+RigidBody& GetRigidBody(World& world, ObjectId objectId);
+const RigidBody& GetRigidBody(const World& world, ObjectId objectId);
+void UpdateRigidBodies(World& world, const Time& time);
 
-RigidBody& AddRigidBody(ObjectId objectId, const Vector2& position, const Vector2& facing);
-RigidBody& GetRigidBody(ObjectId objectId);
-void UpdateRigidBodies(const Time& time);
+void EnsurePlayerIsInsideWorldBounds(World& world);
 
-void EnsurePlayerIsInsideWorldBounds();
+bool BoundingBoxCollidesWithWorldEdge(const World& world, const Vector2& position, const Vector2& facing, const Vector2& dimensions);
+bool CollisionObjectCollidesWithWorldEdge(const World& world, const CollisionObject& object);
 
-bool BoundingBoxCollidesWithWorldEdge(const Vector2& position, const Vector2& facing, const Vector2& dimensions);
-bool CollisionObjectCollidesWithWorldEdge(const CollisionObject& object);
+// the corners of an oriented bounding box, and the separating axis test between two of them
+std::vector<Vector2> GatherBoundingBoxVertices(const Vector2& position, const Vector2& facing, const Vector2& dimensions);
+bool CollisionObjectsCollide(const CollisionObject& objectA, const CollisionObject& objectB);
 
-CollisionObject& AddCollisionObject(ObjectId objectId, const Vector2& boundingBoxDimensions);
-CollisionObject& GetCollisionObject(ObjectId objectId);
-void UpdateCollision(const Time& time, std::vector<std::pair<ObjectId, ObjectId>>& collidingPairs, std::vector<ObjectId>& collidingWithWorld);
+CollisionObject& AddCollisionObject(World& world, ObjectId objectId, const Vector2& boundingBoxDimensions);
+CollisionObject& GetCollisionObject(World& world, ObjectId objectId);
+const CollisionObject& GetCollisionObject(const World& world, ObjectId objectId);
+void UpdateCollision(World& world, const Time& time, std::vector<std::pair<ObjectId, ObjectId>>& collidingPairs, std::vector<ObjectId>& collidingWithWorld);
 
 
@@ -1,5 +1,4 @@
 #include <algorithm>
-#include "SDL.h"
 
 #include "player.h"
 #include "game_object.h"
@@ -11,14 +10,12 @@
 TWEAKABLE(float, playerMovementSpeed, "Player.MovementSpeed", 200.0f, 0.0f, 1000.0f);
 TWEAKABLE(float, playerRotationSpeed, "Player.RotationSpeed", 0.2f, 0.0f, 1.0f);
 TWEAKABLE(float, playerFireRate, "Player.FireRate", 4.0f, 0.0f, 10.0f); // shots per second
+TWEAKABLE(float, scriptedPlayerTargetRadius, "Player.ScriptedTargetRadius", 400.0f, 0.0f, 2000.0f);
 
 
-int playerScore { 0 };
-float playerTimeOfLastShot { 0.0f };
-
-void ApplyPlayerInput(const Time& time, const PlayerInput& playerInput)
+void ApplyPlayerInput(World& world, const Time& time, const PlayerInput& playerInput)
 {
-	auto& playerRB = GetRigidBody(player.objectId);
+	auto& playerRB = GetRigidBody(world, world.player.objectId);
 	playerRB.velocity = playerInput.movement * playerMovementSpeed;
 
 	if (glm::length(playerInput.facing) > 0.5f)
@@ -49,40 +46,49 @@ void ApplyPlayerInput(const Time& time, const PlayerInput& playerInput)
 	//	playerRB.velocity = Vector2 { 0.0f, 0.0f };
 	//}
 
-	if (playerInput.firing && ((time.elapsedTime - playerTimeOfLastShot) > 1.0f / playerFireRate))
+	if (playerInput.firing && ((time.elapsedTime - world.playerTimeOfLastShot) > 1.0f / playerFireRate))
 	{
-		FirePlayerBullet();
-		playerTimeOfLastShot = time.elapsedTime;
+		FirePlayerBullet(world);
+		world.playerTimeOfLastShot = time.elapsedTime;
 	}
 }
 
 
-
-void IncrementPlayerScoreForKilling(ObjectId objectId)
+PlayerInput GetScriptedPlayerInput(const World& world, const Time& time)
 {
-	switch (GetType(objectId))
+	PlayerInput playerInput;
+
+	// drift around a slow loop, turning back towards the center when close to the walls
+	const auto& playerRB = GetRigidBody(world, world.player.objectId);
+	const auto worldCenter = 0.5f * (world.minWorld + world.maxWorld);
+	const auto worldHalfSize = 0.5f * (world.maxWorld - world.minWorld);
+	playerInput.movement = Vector2(sin(0.5f * time.elapsedTime), cos(0.3f * time.elapsedTime));
+	const auto offset = (playerRB.position - worldCenter) / worldHalfSize;
+	if (glm::length(offset) > 0.7f)
 	{
-	case GameObjectType::Player:
-		break;
-	case GameObjectType::Bullet:
-		break;
-	case GameObjectType::AlienRandom:
-		playerScore += 10;
-		break;
-	case GameObjectType::AlienChase:
-		playerScore += 10;
-		break;
-	case GameObjectType::AlienShy:
-		playerScore += 10;
-		break;
-	case GameObjectType::AlienMothership:
-		playerScore += 25;
-		break;
-	case GameObjectType::AlienOffspring:
-		playerScore += 1;
-		break;
-	case GameObjectType::AlienWallHugger:
-		playerScore += 10;
-		break;
+		playerInput.movement = -glm::normalize(offset);
+	}
+
+	// face the nearest alien, firing only when there is one to shoot at
+	float nearestDistance = scriptedPlayerTargetRadius;
+	for (const auto alienId : GetAliensInCircle(world, playerRB.position, scriptedPlayerTargetRadius))
+	{
+		const auto toAlien = GetRigidBody(world, alienId).position - playerRB.position;
+		const auto distance = glm::length(toAlien);
+		if ((distance < nearestDistance) && (distance > 0.0f))
+		{
+			nearestDistance = distance;
+			playerInput.facing = toAlien / distance;
+		}
 	}
+	playerInput.firing = (glm::length(playerInput.facing) > 0.5f);
+
+	return playerInput;
+}
+
+
+
+void IncrementPlayerScoreForKilling(World& world, ObjectId objectId)
+{
+	world.playerScore += GetGameObjectMetaData(GetType(objectId)).score;
 }
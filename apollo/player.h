@@ -4,6 +4,7 @@
 #include "math_helpers.h"
 
 struct Time;
+struct World;
 
 extern float playerMovementSpeed;
 extern float playerRotationSpeed;
@@ -17,9 +18,10 @@ struct PlayerInput
 	bool firing { false };
 };
 
-void ApplyPlayerInput(const Time& time, const PlayerInput& playerInput);
+void ApplyPlayerInput(World& world, const Time& time, const PlayerInput& playerInput);
 
+// a simple pilot for running the game without a joystick, it circles the arena and shoots at the nearest alien
+PlayerInput GetScriptedPlayerInput(const World& world, const Time& time);
 
-extern int playerScore;
 
-void IncrementPlayerScoreForKilling(ObjectId objectId);
+void IncrementPlayerScoreForKilling(World& world, ObjectId objectId);
@@ -1,33 +1,40 @@
 #include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <unordered_map>
 
 #include "profiler.h"
 
+#ifdef _WIN32
 // Define the GUID to use in TraceLoggingProviderRegister 
 // {F053E693-0B6D-4CDE-9AC5-2FE50524C238}
 TRACELOGGING_DEFINE_PROVIDER(
 	ProfilerTraceLoggingProvider,
 	"ApolloTraceLoggingProvider",
 	(0xF053E693, 0x0B6D, 0x4CDE, 0x9A, 0xC5, 0x2F, 0xE5, 0x05, 0x24, 0xC2, 0x38));
+#endif
 
 
 using namespace std;
 
-vector<ProfileEvent> profileEvents;
+thread_local vector<ProfileEvent> profileEvents;
 
 void ProfilerInit()
 {
 	profileEvents.reserve(20000);
 
+#ifdef _WIN32
 	// Register the windows Trace Logging provider
 	TraceLoggingRegister(ProfilerTraceLoggingProvider);
+#endif
 }
 
 void ProfilerShutdown()
 {
+#ifdef _WIN32
 	// Stop TraceLogging and unregister the provider
 	TraceLoggingUnregister(ProfilerTraceLoggingProvider);
+#endif
 }
 
 void ProfilerBeginFrame()
@@ -35,6 +42,11 @@ void ProfilerBeginFrame()
 	profileEvents.clear();
 }
 
+void ProfilerAddThreadEvents(const vector<ProfileEvent>& threadEvents)
+{
+	profileEvents.insert(end(profileEvents), begin(threadEvents), end(threadEvents));
+}
+
 struct DataPointKey
 {
 	const char* filename;
@@ -47,7 +59,7 @@ bool operator==(const DataPointKey& lhs, const DataPointKey& rhs)
 }
 
 template <>
-struct hash<DataPointKey>
+struct std::hash<DataPointKey>
 {
 	size_t operator()(const DataPointKey& key) const
 	{
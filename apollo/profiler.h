@@ -4,6 +4,7 @@
 #include <vector>
 #include <thread>
 
+#ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h> // Defines macros used by TraceLoggingProvider.h
 #undef min
@@ -13,9 +14,11 @@
 
 // Forward-declare the ProfilerTraceLoggingProvider variable that you will use for tracing in this component
 TRACELOGGING_DECLARE_PROVIDER(ProfilerTraceLoggingProvider);
+#endif
 
 #define PROFILER_BEGIN_FRAME() ProfilerBeginFrame()
 
+#ifdef _WIN32
 #define PROFILER_TIMER_FUNCTION() ProfilerBlock timer##__COUNTER__(__FUNCTION__, __FILE__, __LINE__); \
 	TraceLoggingFunction(ProfilerTraceLoggingProvider)
 
@@ -25,6 +28,14 @@ TRACELOGGING_DECLARE_PROVIDER(ProfilerTraceLoggingProvider);
 
 #define PROFILER_TIMER_END(ID) timer##ID.end(); \
 	TraceLoggingWriteStop(traceLoggingActivity, #ID)
+#else
+// TraceLogging is Windows only, elsewhere the blocks are only recorded for the in game profiler
+#define PROFILER_TIMER_FUNCTION() ProfilerBlock timer##__COUNTER__(__FUNCTION__, __FILE__, __LINE__)
+
+#define PROFILER_TIMER_BEGIN(ID) ProfilerBlock timer##ID(#ID, __FILE__, __LINE__)
+
+#define PROFILER_TIMER_END(ID) timer##ID.end()
+#endif
 
 
 using ProfilerTimeUnit = std::chrono::time_point<std::chrono::high_resolution_clock>;
@@ -57,9 +68,12 @@ struct ProfileEvent
 	int line : 31;
 	std::thread::id threadId;
 };
-static_assert(sizeof(ProfileEvent) == 32, "sizeof(ProfileEvent) == 32");
+#ifdef _WIN32
+static_assert(sizeof(ProfileEvent) == 32, "sizeof(ProfileEvent) == 32"); // std::thread::id is 4 bytes on Windows
+#endif
 
-extern std::vector<ProfileEvent> profileEvents;
+// each thread records its own events, a thread that steps a world of its own calls ProfilerBeginFrame every step
+extern thread_local std::vector<ProfileEvent> profileEvents;
 
 inline void ProfilerAddBeginEvent(const char* id, const char* filename, int line)
 {
@@ -71,6 +85,9 @@ inline void ProfilerAddEndEvent(const char* id, const char* filename, int line)
 	profileEvents.emplace_back(ProfileEvent::Type::End, id, filename, line);
 }
 
+// appends the events of a frame recorded by another thread, so that its blocks are included in this thread's statistics
+void ProfilerAddThreadEvents(const std::vector<ProfileEvent>& threadEvents);
+
 
 struct ProfilerBlockStatistics
 {
@@ -110,12 +127,17 @@ struct ProfilerBlock
 		end();
 	}
 
+	// PROFILER_TIMER_END ends the block early, the destructor then leaves it alone
 	void end()
 	{
+		if (ended)
+			return;
 		ProfilerAddEndEvent(id, filename, line);
+		ended = true;
 	}
 
 	const char* const id;
 	const char* const filename;
 	const int line;
+	bool ended { false };
 };
@@ -2,134 +2,145 @@
 
 #include <algorithm>
 #include <cassert>
-#include <memory>
-#include <vector>
-
-#include "ai.h"
-#include "game.h"
-#include "game_object.h"
-#include "math_helpers.h"
-#include "physics.h"
-#include "player.h"
+#include <fstream>
+
 #include "profiler.h"
 #include "world.h"
 
 using namespace std;
 
-struct Snapshot
-{
-	Time time;
-	uint64_t seed;
-	Vector2 minWorld;
-	Vector2 maxWorld;
-
-	PlayerInput playerInput;
-
-	GameObject player;
-	vector<GameObject> aliens;
-	vector<GameObject> bullets;
-
-	vector<RigidBody> rigidBodies;
-	vector<CollisionObject> collisionObjects;
 
-	vector<AIModelAlienRandom> randomAIs;
-	vector<AIModelAlienShy> shyAIs;
-	vector<AIModelAlienChase> chaseAIs;
-	vector<AIModelAlienMothership> mothershipAIs;
-	vector<AIModelAlienOffspring> offspringAIs;
-	vector<AIModelAlienWallHugger> wallHuggerAIs;
-};
-
-vector<Snapshot> snapshots;
-
-
-int CreateSnapshot(Time frameTime, uint64_t frameSeed, const PlayerInput& playerInput)
+int CreateSnapshot(Recording& recording, const World& world, Time frameTime, uint64_t frameSeed, const PlayerInput& playerInput)
 {
 	PROFILER_TIMER_FUNCTION();
 
-	snapshots.emplace_back();
-	auto& snapshot = snapshots.back();
+	recording.snapshots.emplace_back();
+	auto& snapshot = recording.snapshots.back();
 
 	snapshot.time = frameTime;
 	snapshot.seed = frameSeed;
-	snapshot.minWorld = minWorld;
-	snapshot.maxWorld = maxWorld;
+	snapshot.minWorld = world.minWorld;
+	snapshot.maxWorld = world.maxWorld;
 
 	snapshot.playerInput = playerInput;
 
-	snapshot.player = player;
-	snapshot.aliens = aliens;
-	snapshot.bullets = bullets;
-
-	snapshot.rigidBodies = rigidBodies;
-	snapshot.collisionObjects = collisionObjects;
-
-	snapshot.randomAIs = randomAIs;
-	snapshot.shyAIs = shyAIs;
-	snapshot.chaseAIs = chaseAIs;
-	snapshot.mothershipAIs = mothershipAIs;
-	snapshot.offspringAIs = offspringAIs;
-	snapshot.wallHuggerAIs = wallHuggerAIs;
-
-	return static_cast<int>(snapshots.size() - 1);
+	snapshot.player = world.player;
+	snapshot.aliens = world.aliens;
+	snapshot.bullets = world.bullets;
+	snapshot.nextObjectIndex = world.nextObjectIndex;
+	snapshot.playerScore = world.playerScore;
+	snapshot.playerTimeOfLastShot = world.playerTimeOfLastShot;
+	snapshot.worldStatistics = world.statistics;
+	snapshot.lifecycleEventQueue = world.lifecycleEvents.queue;
+
+	snapshot.rigidBodies = world.rigidBodies;
+	snapshot.collisionObjects = world.collisionObjects;
+	snapshot.worldChunks = world.chunks;
+	snapshot.camera = world.camera;
+	snapshot.spawnPlacement = world.spawnPlacement;
+
+	snapshot.aiModelArrays = world.ai.modelArrays;
+	snapshot.aiFrameIndex = world.ai.frameIndex;
+	snapshot.aiTimerWheel = world.ai.timerWheel;
+
+	return static_cast<int>(recording.snapshots.size() - 1);
 }
 
-void ReplaySnapshot(int snapshotIndex, Time& frameTime, uint64_t& frameSeed, PlayerInput& playerInput)
+void ReplaySnapshot(const Recording& recording, int snapshotIndex, World& world, Time& frameTime, uint64_t& frameSeed, PlayerInput& playerInput)
 {
-	assert((snapshotIndex >= 0) && (snapshotIndex < snapshots.size()));
-	const auto& snapshot = snapshots[snapshotIndex];
+	assert((snapshotIndex >= 0) && (snapshotIndex < GetSnapshotCount(recording)));
+	const auto& snapshot = recording.snapshots[snapshotIndex];
 
 	frameTime = snapshot.time;
 	frameSeed = snapshot.seed;
-	minWorld = snapshot.minWorld;
-	maxWorld = snapshot.maxWorld;
+	world.minWorld = snapshot.minWorld;
+	world.maxWorld = snapshot.maxWorld;
 
 	playerInput = snapshot.playerInput;
 
-	player = snapshot.player;
-	aliens = snapshot.aliens;
-	bullets = snapshot.bullets;
-
-	rigidBodies = snapshot.rigidBodies;
-	collisionObjects = snapshot.collisionObjects;
-
-	randomAIs = snapshot.randomAIs;
-	shyAIs = snapshot.shyAIs;
-	chaseAIs = snapshot.chaseAIs;
-	mothershipAIs = snapshot.mothershipAIs;
-	offspringAIs = snapshot.offspringAIs;
-	wallHuggerAIs = snapshot.wallHuggerAIs;
+	world.player = snapshot.player;
+	world.aliens = snapshot.aliens;
+	world.bullets = snapshot.bullets;
+	world.nextObjectIndex = snapshot.nextObjectIndex;
+	world.playerScore = snapshot.playerScore;
+	world.playerTimeOfLastShot = snapshot.playerTimeOfLastShot;
+	world.statistics = snapshot.worldStatistics;
+	world.lifecycleEvents.queue = snapshot.lifecycleEventQueue;
+
+	world.rigidBodies = snapshot.rigidBodies;
+	world.collisionObjects = snapshot.collisionObjects;
+	world.chunks = snapshot.worldChunks;
+	world.camera = snapshot.camera;
+	world.spawnPlacement = snapshot.spawnPlacement;
+
+	world.ai.modelArrays = snapshot.aiModelArrays;
+	world.ai.frameIndex = snapshot.aiFrameIndex;
+	world.ai.timerWheel = snapshot.aiTimerWheel;
+	RestartAIBehaviours(world, frameTime.elapsedTime);
 }
 
-int GetSnapshotCount()
+int GetSnapshotCount(const Recording& recording)
 {
-	return static_cast<int>(snapshots.size());
+	return static_cast<int>(recording.snapshots.size());
 }
 
-void ValidateSnapshot(int snapshotIndex, Time frameTime, uint64_t frameSeed)
+// only checks anything when the asserts are compiled in
+void ValidateSnapshot(const Recording& recording, int snapshotIndex, const World& world, [[maybe_unused]] Time frameTime, [[maybe_unused]] uint64_t frameSeed)
 {
 	PROFILER_TIMER_FUNCTION();
 
-	assert((snapshotIndex >= 0) && (snapshotIndex < snapshots.size()));
-	const auto& snapshot = snapshots[snapshotIndex];
+	assert((snapshotIndex >= 0) && (snapshotIndex < GetSnapshotCount(recording)));
+	const auto& snapshot = recording.snapshots[snapshotIndex];
 
 	assert(snapshot.time == frameTime);
 	assert(snapshot.seed == frameSeed);
-	assert(snapshot.minWorld == minWorld);
-	assert(snapshot.maxWorld == maxWorld);
-
-	assert(snapshot.player.objectId == player.objectId);
-	assert(snapshot.aliens.size() == aliens.size());
-	assert(snapshot.bullets.size() == bullets.size());
-
-	assert(snapshot.rigidBodies.size() == rigidBodies.size());
-	assert(snapshot.collisionObjects.size() == collisionObjects.size());
-
-	assert(snapshot.randomAIs.size() == randomAIs.size());
-	assert(snapshot.shyAIs.size() == shyAIs.size());
-	assert(snapshot.chaseAIs.size() == chaseAIs.size());
-	assert(snapshot.mothershipAIs.size() == mothershipAIs.size());
-	assert(snapshot.offspringAIs.size() == offspringAIs.size());
-	assert(snapshot.wallHuggerAIs.size() == wallHuggerAIs.size());
+	assert(snapshot.minWorld == world.minWorld);
+	assert(snapshot.maxWorld == world.maxWorld);
+
+	assert(snapshot.player.objectId == world.player.objectId);
+	assert(snapshot.aliens.size() == world.aliens.size());
+	assert(snapshot.bullets.size() == world.bullets.size());
+
+	assert(snapshot.rigidBodies.size() == world.rigidBodies.size());
+	assert(snapshot.collisionObjects.size() == world.collisionObjects.size());
+	assert(snapshot.spawnPlacement.worldCandidates.freeCount == world.spawnPlacement.worldCandidates.freeCount);
+	assert(snapshot.spawnPlacement.wallCandidates.freeCount == world.spawnPlacement.wallCandidates.freeCount);
+
+	ForEachGameObjectType(AIGameObjectTypes {}, [&snapshot, &world] <GameObjectType Type> () {
+		using AIModel [[maybe_unused]] = typename GameObjectTraits<Type>::AIModel;
+		assert(get<AIModelArray<AIModel>>(snapshot.aiModelArrays).models.size() == GetAIModels<AIModel>(world.ai).models.size());
+	});
+}
+
+
+bool SavePlayerInputs(const char* filename, const vector<PlayerInput>& playerInputs)
+{
+	ofstream file(filename);
+	if (!file)
+		return false;
+
+	file.precision(9);
+	for (const auto& playerInput : playerInputs)
+	{
+		file << playerInput.movement.x << ' ' << playerInput.movement.y << ' ' << playerInput.facing.x << ' ' << playerInput.facing.y << ' ' << (playerInput.firing ? 1 : 0) << '\n';
+	}
+	return static_cast<bool>(file);
 }
 
+
+bool LoadPlayerInputs(const char* filename, vector<PlayerInput>& playerInputs)
+{
+	ifstream file(filename);
+	if (!file)
+		return false;
+
+	playerInputs.clear();
+	PlayerInput playerInput;
+	int firing = 0;
+	while (file >> playerInput.movement.x >> playerInput.movement.y >> playerInput.facing.x >> playerInput.facing.y >> firing)
+	{
+		playerInput.firing = (firing != 0);
+		playerInputs.push_back(playerInput);
+	}
+	return file.eof();
+}
@@ -1,17 +1,68 @@
 #pragma once
 
 #include <cstdint>
+#include <vector>
 
+#include "ai.h"
+#include "camera.h"
 #include "game.h"
+#include "game_object.h"
+#include "lifecycle_events.h"
+#include "math_helpers.h"
+#include "physics.h"
+#include "player.h"
+#include "spawn_placement.h"
+#include "timer_wheel.h"
+#include "world_chunks.h"
+#include "world_statistics.h"
 
-struct PlayerInput;
+struct World;
 
-int CreateSnapshot(Time frameTime, uint64_t frameSeed, const PlayerInput& playerInput);
+struct Snapshot
+{
+	Time time;
+	uint64_t seed;
+	Vector2 minWorld;
+	Vector2 maxWorld;
 
-void ReplaySnapshot(int snapshotIndex, Time& frameTime, uint64_t& frameSeed, PlayerInput& playerInput);
+	PlayerInput playerInput;
 
-int GetSnapshotCount();
+	GameObject player;
+	std::vector<GameObject> aliens;
+	std::vector<GameObject> bullets;
+	uint32_t nextObjectIndex;
+	int playerScore;
+	float playerTimeOfLastShot;
+	WorldStatistics worldStatistics;
+	std::vector<LifecycleEvent> lifecycleEventQueue;
 
-void ValidateSnapshot(int snapshotIndex, Time frameTime, uint64_t frameSeed);
+	std::vector<RigidBody> rigidBodies;
+	std::vector<CollisionObject> collisionObjects;
+	WorldChunks worldChunks;
+	Camera camera;
+	SpawnPlacement spawnPlacement; // the spawns draw from its candidate order with the world random
 
+	AIModelArrays aiModelArrays;
+	uint32_t aiFrameIndex;
+	TimerWheel aiTimerWheel;
+};
+
+// the snapshots of one world, one per frame played
+struct Recording
+{
+	std::vector<Snapshot> snapshots;
+};
+
+int CreateSnapshot(Recording& recording, const World& world, Time frameTime, uint64_t frameSeed, const PlayerInput& playerInput);
+
+void ReplaySnapshot(const Recording& recording, int snapshotIndex, World& world, Time& frameTime, uint64_t& frameSeed, PlayerInput& playerInput);
+
+int GetSnapshotCount(const Recording& recording);
+
+void ValidateSnapshot(const Recording& recording, int snapshotIndex, const World& world, Time frameTime, uint64_t frameSeed);
+
+
+// the player input of every frame as text, one frame per line, so that a game can be played again without the snapshots
+bool SavePlayerInputs(const char* filename, const std::vector<PlayerInput>& playerInputs);
+bool LoadPlayerInputs(const char* filename, std::vector<PlayerInput>& playerInputs);
 
@@ -0,0 +1,78 @@
+#include "render_queue.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "profiler.h"
+
+using namespace std;
+
+
+namespace
+{
+	// a stable least significant digit radix sort, a byte at a time, skipping the bytes that all of the keys share
+	void RadixSortRenderPackets(vector<RenderPacket>& packets, vector<RenderPacket>& scratch)
+	{
+		scratch.resize(packets.size());
+		for (int shift = 0; shift < 64; shift += 8)
+		{
+			size_t counts[256] {};
+			for (const auto& packet : packets)
+				++counts[(packet.sortKey >> shift) & 0xff];
+			if (*max_element(begin(counts), end(counts)) == packets.size())
+				continue;
+
+			size_t offsets[256];
+			size_t offset = 0;
+			for (int digit = 0; digit < 256; ++digit)
+			{
+				offsets[digit] = offset;
+				offset += counts[digit];
+			}
+			for (const auto& packet : packets)
+				scratch[offsets[(packet.sortKey >> shift) & 0xff]++] = packet;
+			packets.swap(scratch);
+		}
+	}
+}
+
+
+size_t AllocateRenderPacketData(RenderQueue& renderQueue, size_t size, size_t alignment)
+{
+	assert((alignment > 0) && ((alignment & (alignment - 1)) == 0));
+	const size_t dataOffset = (renderQueue.packetData.size() + alignment - 1) & ~(alignment - 1);
+	renderQueue.packetData.resize(dataOffset + size);
+	return dataOffset;
+}
+
+
+void ExecuteRenderQueue(RenderQueue& renderQueue)
+{
+	PROFILER_TIMER_FUNCTION();
+
+	auto& packets = renderQueue.sortedPackets;
+	packets.assign(begin(renderQueue.packets), end(renderQueue.packets));
+	renderQueue.packets.clear();
+
+	// the packets are submitted more or less in order, the scratch space is the submission buffer
+	RadixSortRenderPackets(packets, renderQueue.packets);
+	renderQueue.packets.clear();
+
+	RenderQueueStatistics statistics;
+	void (*currentSetup)(const void*) = nullptr;
+	for (const auto& packet : packets)
+	{
+		const void* data = renderQueue.packetData.data() + packet.dataOffset;
+		if (packet.setup && (packet.setup != currentSetup))
+		{
+			packet.setup(data);
+			++statistics.setups;
+		}
+		currentSetup = packet.setup;
+		packet.execute(data);
+		++statistics.packets;
+	}
+
+	renderQueue.statistics = statistics;
+	renderQueue.packetData.clear();
+}
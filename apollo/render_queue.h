@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+
+// The draws of a frame are submitted as packets with a sort key and executed together, sorted by their keys, once the
+// frame has been submitted. The layers are drawn back to front, and within a layer the packets that use the same shader
+// and texture are next to each other. A packet may have a setup function, for the state that it shares with the
+// packets around it, which is only called when it differs from the setup of the packet before.
+
+enum class RenderLayer : uint8_t { World, Debug, UI, Profiler };
+enum class RenderShader : uint8_t { Sprite, DebugDraw, Text };
+
+// layer:8 shader:8 texture:16 depth:32, the depth sorts front to back within the rest of the key
+inline uint64_t MakeRenderSortKey(RenderLayer layer, RenderShader shader, uint32_t texture, uint32_t depth)
+{
+	return (static_cast<uint64_t>(layer) << 56) | (static_cast<uint64_t>(shader) << 48) | (static_cast<uint64_t>(texture & 0xffff) << 32) | depth;
+}
+
+struct RenderPacket
+{
+	uint64_t sortKey;
+	void (*execute)(const void* data);
+	void (*setup)(const void* data);
+	size_t dataOffset;
+};
+
+struct RenderQueueStatistics
+{
+	int packets { 0 };
+	int setups { 0 };
+};
+
+struct RenderQueue
+{
+	std::vector<RenderPacket> packets;
+	std::vector<RenderPacket> sortedPackets;
+	std::vector<uint8_t> packetData; // the packets' copies of their data
+	RenderQueueStatistics statistics; // of the last execution
+};
+
+size_t AllocateRenderPacketData(RenderQueue& renderQueue, size_t size, size_t alignment);
+
+// the data is copied into the queue, so it only has to live until the call returns
+template <typename Data, void (*Execute)(const Data&), void (*Setup)(const Data&) = nullptr>
+void SubmitRenderPacket(RenderQueue& renderQueue, uint64_t sortKey, const Data& data)
+{
+	static_assert(std::is_trivially_copyable_v<Data>, "render packet data is copied as bytes");
+	const size_t dataOffset = AllocateRenderPacketData(renderQueue, sizeof(Data), alignof(Data));
+	memcpy(renderQueue.packetData.data() + dataOffset, &data, sizeof(Data));
+
+	RenderPacket packet { sortKey, [] (const void* packetData) { Execute(*static_cast<const Data*>(packetData)); }, nullptr, dataOffset };
+	if constexpr (Setup != nullptr)
+		packet.setup = [] (const void* packetData) { Setup(*static_cast<const Data*>(packetData)); };
+	renderQueue.packets.push_back(packet);
+}
+
+// sorts and executes the packets, then empties the queue for the next frame
+void ExecuteRenderQueue(RenderQueue& renderQueue);
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "ai.h"
+#include "camera.h"
+#include "game.h"
+#include "math_helpers.h"
+#include "profiler.h"
+#include "rendering.h"
+#include "spawn_placement.h"
+#include "sprite.h"
+#include "world_statistics.h"
+
+
+// Everything the renderer needs from a frame of the simulation. The simulation thread captures it at the end of each
+// frame, and the main thread draws it while the simulation steps the next frame, so the renderer never reads the world.
+struct RenderSnapshotLine
+{
+	Vector2 begin;
+	Vector2 end;
+	Color color;
+};
+
+struct RenderSnapshot
+{
+	Time time;
+	Camera camera;
+	std::vector<SpriteInstance> sprites; // in the order they are drawn, only those that the camera can see
+	int culledSpriteCount { 0 }; // in the visible chunks but outside the view
+	std::vector<RenderSnapshotLine> debugLines;
+
+	// the ui
+	int playerScore { 0 };
+	bool isGameOver { false };
+
+	// the profiler overlay
+	std::vector<ProfileEvent> profileEvents; // recorded by the simulation thread during the frame
+	AISchedulerStatistics aiStatistics;
+	SpawnPlacementStatistics spawnStatistics;
+	int activeChunkCount { 0 };
+	int chunkCount { 0 };
+	int activeObjectCount { 0 };
+	std::array<GameObjectTypeStatistics, static_cast<size_t>(GameObjectType::Count)> typeStatistics;
+	int liveAlienCount { 0 };
+	int livePlayerBulletCount { 0 };
+	int liveAlienBulletCount { 0 };
+};
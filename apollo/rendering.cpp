@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <cmath>
 #include <memory>
 #include <iostream>
 #include <fstream>
@@ -21,27 +22,41 @@
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 
+#include "ai.h"
+#include "camera.h"
 #include "game.h"
 #include "gl_helpers.h"
+#include "gpu_profiler.h"
 #include "debug_draw.h"
+#include "flow_field.h"
 #include "math_helpers.h"
 #include "physics.h"
 #include "player.h"
 #include "profiler.h"
+#include "render_queue.h"
+#include "render_snapshot.h"
+#include "spawn_placement.h"
 #include "sprite.h"
 #include "tweakables.h"
 #include "game_object.h"
 #include "world.h"
+#include "world_chunks.h"
+#include "world_statistics.h"
 
 using namespace std;
 
 TWEAKABLE(bool, renderBoundingBoxes, "Physics.RenderBoundingBoxes", false, false, true);
 TWEAKABLE(bool, renderDeadObjects, "Physics.RenderDeadObjects", false, false, true);
+TWEAKABLE(bool, renderFlowField, "AI.RenderFlowField", false, false, true);
 
 unique_ptr<struct FONScontext, decltype(&glfonsDelete)> fontStash { 0, glfonsDelete };
 int fontNormal;
 
 SpriteShader spriteShader;
+SpriteAtlas spriteAtlas;
+GLStreamBuffer spriteInstanceBuffer;
+
+RenderQueue renderQueue;
 
 struct RenderModel
 {
@@ -57,7 +72,7 @@ static vector<unique_ptr<RenderModel>> renderModels; // set an arbitrary initial
 
 void CreateRenderModel(GameObjectType gameObjectType, const char* spriteName)
 {
-	auto renderModel = make_unique<RenderModel>(CreateSprite(spriteName));
+	auto renderModel = make_unique<RenderModel>(GetSprite(spriteAtlas, spriteName));
 
 	if (renderModels.size() <= static_cast<int>(gameObjectType))
 		renderModels.resize(static_cast<int>(gameObjectType) + 1);
@@ -82,7 +97,18 @@ bool LoadResources()
 	if (!spriteShader.program)
 		return false;
 
-	renderModels.reserve(10);
+	// every sprite, including the debug draw line, is packed into the one atlas texture
+	vector<string> spriteFilenames { "debug_line.png" };
+	for (const auto& metaData : gameObjectMetaDatas)
+	{
+		if (find(begin(spriteFilenames), end(spriteFilenames), metaData.spriteFilename) == end(spriteFilenames))
+			spriteFilenames.push_back(metaData.spriteFilename);
+	}
+	spriteAtlas = CreateSpriteAtlas(spriteFilenames);
+	if (!spriteAtlas.texture)
+		return false;
+
+	renderModels.reserve(gameObjectMetaDatas.size());
 	for (const auto& metaData : gameObjectMetaDatas)
 	{
 		CreateRenderModel(metaData.type, metaData.spriteFilename);
@@ -92,79 +118,229 @@ bool LoadResources()
 }
 
 
+void UnloadResources()
+{
+	spriteInstanceBuffer.Destroy();
+}
+
 
-void RenderWorld(const Time& /*time*/, int windowWidth, int windowHeight)
+const SpriteAtlas& GetSpriteAtlas()
 {
-	PROFILER_TIMER_FUNCTION();
+	return spriteAtlas;
+}
 
-	glViewport(0, 0, windowWidth, windowHeight);
-	glClearColor(0, 0, 0.2f, 1);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	glDisable(GL_DEPTH_TEST);
+RenderQueue& GetRenderQueue()
+{
+	return renderQueue;
+}
+
 
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+namespace
+{
+	struct SpritesPacket
+	{
+		const vector<SpriteInstance>* sprites; // in the snapshot, which is drawn before the simulation can replace it
+		glm::mat4 projectionMatrix;
+	};
 
-	glUseProgram(spriteShader.program);
+	void ExecuteSpritesPacket(const SpritesPacket& packet)
+	{
+		GPU_PROFILER_TIMER_BEGIN(sprites);
 
-	auto projectionMatrix = glm::ortho(-windowWidth / 2.0f, windowWidth / 2.0f, -windowHeight / 2.0f, windowHeight / 2.0f, -10.0f, 10.0f);
+		CachedSetBlend(true, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-	// draw the walls
-	DebugDrawLine(Vector2 { minWorld.x, minWorld.y }, Vector2 { minWorld.x, maxWorld.y }, Color::White);
-	DebugDrawLine(Vector2 { minWorld.x, minWorld.y }, Vector2 { maxWorld.x, minWorld.y }, Color::White);
-	DebugDrawLine(Vector2 { maxWorld.x, maxWorld.y }, Vector2 { minWorld.x, maxWorld.y }, Color::White);
-	DebugDrawLine(Vector2 { maxWorld.x, maxWorld.y }, Vector2 { maxWorld.x, minWorld.y }, Color::White);
+		// every sprite comes from the atlas, so the whole world is one draw
+		DrawSpriteInstances(*packet.sprites, spriteInstanceBuffer, spriteAtlas, spriteShader, packet.projectionMatrix);
+	}
 
-	// draw the bullets
-	for_each(begin(bullets), end(bullets), [&projectionMatrix] (const GameObject& bullet)
+	// a line of fontstash text, in pixels from the top left of the window
+	struct TextPacket
 	{
-		if (bullet.isAlive)
-		{
-			auto& bulletRB = GetRigidBody(bullet.objectId);
-			const auto& renderModel = GetRenderModel(GetType(bullet.objectId));
-			auto modelviewMatrix = CreateSpriteModelviewMatrix(renderModel.sprite, bulletRB.position, bulletRB.facing);
-			DrawSprite(renderModel.sprite, spriteShader, modelviewMatrix, projectionMatrix);
-		}
-	});
+		float x;
+		float y;
+		int windowWidth;
+		int windowHeight;
+		char text[256];
+	};
+
+	void SetupTextPacket(const TextPacket& packet)
+	{
+		// fontstash expects to find the defaults, and changes the textures and blending behind the cache's back
+		GLStateCacheRestoreDefaults();
+		GLStateCacheInvalidate();
+
+		glMatrixMode(GL_MODELVIEW);
+		glLoadIdentity();
+		glMatrixMode(GL_PROJECTION);
+		glLoadIdentity();
+		glOrtho(0, packet.windowWidth, packet.windowHeight, 0, -10.0f, 10.0f);
+
+		fonsSetFont(fontStash.get(), fontNormal);
+		fonsSetSize(fontStash.get(), 24.0f);
+		fonsSetColor(fontStash.get(), glfonsRGBA(255, 255, 255, 255));
+	}
 
-	// draw the aliens
-	for_each(begin(aliens), end(aliens), [&projectionMatrix] (const GameObject& enemy)
+	void ExecuteTextPacket(const TextPacket& packet)
 	{
-		if (enemy.isAlive)
+		fonsDrawText(fontStash.get(), packet.x, packet.y, packet.text, nullptr);
+	}
+
+	void SubmitText(RenderLayer layer, int windowWidth, int windowHeight, float x, float y, const char* text)
+	{
+		TextPacket packet { x, y, windowWidth, windowHeight, {} };
+		snprintf(packet.text, sizeof(packet.text), "%s", text);
+		SubmitRenderPacket<TextPacket, ExecuteTextPacket, SetupTextPacket>(renderQueue, MakeRenderSortKey(layer, RenderShader::Text, 0, 0), packet);
+	}
+}
+
+
+
+void CaptureRenderSnapshot(const World& world, const Time& time, const CameraView& cameraView, RenderSnapshot& snapshot)
+{
+	PROFILER_TIMER_FUNCTION();
+
+	snapshot.time = time;
+	snapshot.camera = ApplyCameraView(world.camera, cameraView);
+
+	// only the chunks that the camera can see are visited, with a margin for the sprites that overlap the edge of the
+	// view, and then each sprite is culled against the view itself before anything else is done with it
+	const Vector2 viewMin = GetCameraViewMin(snapshot.camera);
+	const Vector2 viewMax = GetCameraViewMax(snapshot.camera);
+	const Vector2 spriteMargin { 64.0f, 64.0f };
+	const Vector2 visibleMin = viewMin - spriteMargin;
+	const Vector2 visibleMax = viewMax + spriteMargin;
+	auto isVisible = [&viewMin, &viewMax] (const Vector2& position, float radius)
+	{
+		return (position.x + radius >= viewMin.x) && (position.x - radius <= viewMax.x) && (position.y + radius >= viewMin.y) && (position.y - radius <= viewMax.y);
+	};
+
+	// the bullets, then the aliens, then the player on top, the world chunks only list live objects
+	auto& sprites = snapshot.sprites;
+	sprites.clear();
+	int culledSpriteCount = 0;
+	auto addSprite = [&world, &sprites, &culledSpriteCount, &isVisible] (ObjectId objectId)
+	{
+		const auto& renderModel = GetRenderModel(GetType(objectId));
+		const auto& rigidBody = GetRigidBody(world, objectId);
+		// the radius of the sprite at any facing
+		if (!isVisible(rigidBody.position, 0.5f * glm::length(renderModel.sprite.dimensions)))
 		{
-			auto& enemyRB = GetRigidBody(enemy.objectId);
-			const auto& renderModel = GetRenderModel(GetType(enemy.objectId));
-			auto modelviewMatrix = CreateSpriteModelviewMatrix(renderModel.sprite, enemyRB.position, enemyRB.facing);
-			DrawSprite(renderModel.sprite, spriteShader, modelviewMatrix, projectionMatrix);
+			++culledSpriteCount;
+			return;
 		}
+		AddSpriteInstance(sprites, renderModel.sprite, rigidBody.position, rigidBody.facing);
+	};
+	ForEachObjectInWorldChunks(world.chunks, visibleMin, visibleMax, [&addSprite] (ObjectId objectId)
+	{
+		if (GetType(objectId) == GameObjectType::Bullet)
+			addSprite(objectId);
 	});
-
-	// draw the player
+	ForEachObjectInWorldChunks(world.chunks, visibleMin, visibleMax, [&addSprite] (ObjectId objectId)
 	{
-		auto& playerRB = GetRigidBody(player.objectId);
-		const auto& renderModel = GetRenderModel(GetType(player.objectId));
-		auto modelviewMatrix = CreateSpriteModelviewMatrix(renderModel.sprite, playerRB.position, playerRB.facing);
-		DrawSprite(renderModel.sprite, spriteShader, modelviewMatrix, projectionMatrix);
-	}
+		if ((GetType(objectId) != GameObjectType::Bullet) && (GetType(objectId) != GameObjectType::Player))
+			addSprite(objectId);
+	});
+	addSprite(world.player.objectId);
+	snapshot.culledSpriteCount = culledSpriteCount;
 
-	// draw the collision world
+	// the debug draw isn't thread safe, so the lines are kept in the snapshot until the main thread draws it
+	auto& debugLines = snapshot.debugLines;
+	debugLines.clear();
+	auto addBox = [&debugLines] (const glm::mat4& transform, float w, float h, Color color)
+	{
+		auto a = glm::vec2(transform * glm::vec4(-w / 2.0f, -h / 2.0f, 0.0f, 1.0f));
+		auto b = glm::vec2(transform * glm::vec4(-w / 2.0f, h / 2.0f, 0.0f, 1.0f));
+		auto c = glm::vec2(transform * glm::vec4(w / 2.0f, h / 2.0f, 0.0f, 1.0f));
+		auto d = glm::vec2(transform * glm::vec4(w / 2.0f, -h / 2.0f, 0.0f, 1.0f));
+		debugLines.insert(debugLines.end(), { { a, b, color }, { b, c, color }, { c, d, color }, { d, a, color } });
+	};
+
+	// the walls
+	const Vector2& minWorld = world.minWorld;
+	const Vector2& maxWorld = world.maxWorld;
+	debugLines.push_back({ Vector2 { minWorld.x, minWorld.y }, Vector2 { minWorld.x, maxWorld.y }, Color::White });
+	debugLines.push_back({ Vector2 { minWorld.x, minWorld.y }, Vector2 { maxWorld.x, minWorld.y }, Color::White });
+	debugLines.push_back({ Vector2 { maxWorld.x, maxWorld.y }, Vector2 { minWorld.x, maxWorld.y }, Color::White });
+	debugLines.push_back({ Vector2 { maxWorld.x, maxWorld.y }, Vector2 { maxWorld.x, minWorld.y }, Color::White });
+
+	// the collision world
 	if (renderBoundingBoxes || renderDeadObjects)
 	{
-		for_each(begin(collisionObjects), end(collisionObjects), [] (const auto& collisionObject)
+		for_each(begin(world.collisionObjects), end(world.collisionObjects), [&world, &addBox, &isVisible] (const auto& collisionObject)
 		{
-			auto& gameObject = GetGameObject(collisionObject.objectId);
+			if (!isVisible(collisionObject.position, 0.5f * glm::length(collisionObject.boundingBoxDimensions)))
+				return;
+
+			auto& gameObject = GetGameObject(world, collisionObject.objectId);
 			auto transform = CalculateObjectTransform(collisionObject.position, collisionObject.facing);
 			float w = collisionObject.boundingBoxDimensions.x;
 			float h = collisionObject.boundingBoxDimensions.y;
 			auto color = gameObject.isAlive ? Color::White : Color::Gray;
 			if ((renderBoundingBoxes && gameObject.isAlive) || (renderDeadObjects && !gameObject.isAlive))
 			{
-				DebugDrawBox(transform, w, h, color);
+				addBox(transform, w, h, color);
 			}
 		});
 	}
 
+	// the flow field
+	if (renderFlowField)
+	{
+		// only the cells under the view
+		const auto& flowField = world.flowField;
+		const int minX = max(static_cast<int>(floor((viewMin.x - flowField.origin.x) / flowField.cellSize)), 0);
+		const int minY = max(static_cast<int>(floor((viewMin.y - flowField.origin.y) / flowField.cellSize)), 0);
+		const int maxX = min(static_cast<int>(floor((viewMax.x - flowField.origin.x) / flowField.cellSize)), flowField.width - 1);
+		const int maxY = min(static_cast<int>(floor((viewMax.y - flowField.origin.y) / flowField.cellSize)), flowField.height - 1);
+		for (int y = minY; y <= maxY; ++y)
+		{
+			for (int x = minX; x <= maxX; ++x)
+			{
+				const auto& cell = flowField.cells[y * flowField.width + x];
+				Vector2 cellCenter = flowField.origin + flowField.cellSize * Vector2 { x + 0.5f, y + 0.5f };
+				auto color = (cell.alienCount > 0) ? Color::Orange : Color::DarkGray;
+				debugLines.push_back({ cellCenter, cellCenter + 0.4f * flowField.cellSize * cell.playerDirection, color });
+			}
+		}
+	}
+
+	snapshot.playerScore = world.playerScore;
+	snapshot.isGameOver = IsGameOver(world);
+
+	snapshot.aiStatistics = GetAISchedulerStatistics(world);
+	snapshot.spawnStatistics = GetSpawnPlacementStatistics(world);
+	const auto& worldChunks = world.chunks;
+	snapshot.activeChunkCount = (worldChunks.activeMaxX - worldChunks.activeMinX + 1) * (worldChunks.activeMaxY - worldChunks.activeMinY + 1);
+	snapshot.chunkCount = static_cast<int>(worldChunks.chunks.size());
+	snapshot.activeObjectCount = static_cast<int>(worldChunks.activeObjectIds.size());
+	for (size_t typeIndex = 0; typeIndex < snapshot.typeStatistics.size(); ++typeIndex)
+		snapshot.typeStatistics[typeIndex] = GetGameObjectTypeStatistics(world, static_cast<GameObjectType>(typeIndex));
+	snapshot.liveAlienCount = GetLiveAlienCount(world);
+	snapshot.livePlayerBulletCount = GetLiveBulletCount(world, CollisionLayer::PlayerBullet);
+	snapshot.liveAlienBulletCount = GetLiveBulletCount(world, CollisionLayer::Alien);
+}
+
+
+void RenderWorld(const RenderSnapshot& snapshot, int windowWidth, int windowHeight)
+{
+	PROFILER_TIMER_FUNCTION();
+
+	{
+		GPU_PROFILER_TIMER_BEGIN(clear);
+		glViewport(0, 0, windowWidth, windowHeight);
+		glClearColor(0, 0, 0.2f, 1);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	}
+
+	glDisable(GL_DEPTH_TEST);
+
+	SpritesPacket packet { &snapshot.sprites, CalculateCameraProjectionMatrix(snapshot.camera) };
+	SubmitRenderPacket<SpritesPacket, ExecuteSpritesPacket>(renderQueue, MakeRenderSortKey(RenderLayer::World, RenderShader::Sprite, spriteAtlas.texture, 0), packet);
+
+	for (const auto& line : snapshot.debugLines)
+		DebugDrawLine(line.begin, line.end, line.color);
+
 	CheckOpenGLErrors();
 }
 
@@ -192,7 +368,7 @@ void LoadCredits()
 	}
 }
 
-void RollCredits(const Time& time)
+void RollCredits(const Time& time, int windowWidth, int windowHeight)
 {
 	if (credits.size() == 0)
 		LoadCredits();
@@ -200,51 +376,33 @@ void RollCredits(const Time& time)
 	static float height = 250.0f;
 	height += -20.0f * time.deltaTime;
 
-	fonsSetFont(fontStash.get(), fontNormal);
-	fonsSetSize(fontStash.get(), 24.0f);
-	fonsSetColor(fontStash.get(), glfonsRGBA(255, 255, 255, 255));
-	float dx = -100.0f, dy = height;
+	float dx = windowWidth / 2.0f - 100.0f, dy = windowHeight / 2.0f + height;
 	for (const auto& line : credits)
 	{
-		fonsDrawText(fontStash.get(), dx, dy, line.c_str(), nullptr);
+		SubmitText(RenderLayer::UI, windowWidth, windowHeight, dx, dy, line.c_str());
 		dy += 20.0f;
 	}
 }
 
 
 
-void RenderUI(const Time& time, int windowWidth, int windowHeight)
+void RenderUI(const RenderSnapshot& snapshot, int windowWidth, int windowHeight)
 {
 	PROFILER_TIMER_FUNCTION();
 
-	glMatrixMode(GL_MODELVIEW);
-	glLoadIdentity();
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
-	glOrtho(-windowWidth / 2.0f, windowWidth / 2.0f, windowHeight / 2.0f, -windowHeight / 2.0f, -10.0f, 10.0f);
-
-	float dx = -windowWidth / 2.0f;
-	float dy = -windowHeight / 2.0f + 20.0f;
-	fonsSetFont(fontStash.get(), fontNormal);
-	fonsSetSize(fontStash.get(), 24.0f);
-	fonsSetColor(fontStash.get(), glfonsRGBA(255, 255, 255, 255));
-	fonsDrawText(fontStash.get(), dx, dy, "Apollo", nullptr);
-
+	float dx = 0.0f;
+	float dy = 20.0f;
+	SubmitText(RenderLayer::UI, windowWidth, windowHeight, dx, dy, "Apollo");
 
-	dx = windowWidth / 2.0f - 160.0f;
-	fonsSetFont(fontStash.get(), fontNormal);
-	fonsSetSize(fontStash.get(), 24.0f);
-	fonsSetColor(fontStash.get(), glfonsRGBA(255, 255, 255, 255));
+	dx = windowWidth - 160.0f;
 	char scoreText[24];
-	snprintf(scoreText, 24, "Score: %04d", playerScore);
-	fonsDrawText(fontStash.get(), dx, dy, scoreText, nullptr);
+	snprintf(scoreText, 24, "Score: %04d", snapshot.playerScore);
+	SubmitText(RenderLayer::UI, windowWidth, windowHeight, dx, dy, scoreText);
 
-	if (IsGameOver())
+	if (snapshot.isGameOver)
 	{
-		RollCredits(time);
+		RollCredits(snapshot.time, windowWidth, windowHeight);
 	}
-
-	CheckOpenGLErrors();
 }
 
 
@@ -305,16 +463,10 @@ void RenderDebugUI(const Time& /*time*/, int /*windowWidth*/, int /*windowHeight
 
 
 
-void RenderProfiler(const Time& /*time*/, int windowWidth, int windowHeight, ProfilerRenderingMode renderingMode)
+void RenderProfiler(const RenderSnapshot& snapshot, int windowWidth, int windowHeight, ProfilerRenderingMode renderingMode)
 {
 	PROFILER_TIMER_FUNCTION();
 
-	glMatrixMode(GL_MODELVIEW);
-	glLoadIdentity();
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
-	glOrtho(0, windowWidth, windowHeight, 0, -10.0f, 10.0f);
-
 	const auto& accumulatedStatistics = ProfilerGetAccumulatedStatistics();
 
 	const auto& lastFrameStatistics = accumulatedStatistics.back();
@@ -324,23 +476,83 @@ void RenderProfiler(const Time& /*time*/, int windowWidth, int windowHeight, Pro
 	{
 		if (dataPoint.hitCount > 0)
 		{
-			fonsSetFont(fontStash.get(), fontNormal);
-			fonsSetSize(fontStash.get(), 24.0f);
-			fonsSetColor(fontStash.get(), glfonsRGBA(255, 255, 255, 255));
 			char text[255];
 			_snprintf_s(text, 255, "%-40s %9lldus %8d %9lldus", dataPoint.id, dataPoint.duration.count() / 1000, dataPoint.hitCount, dataPoint.duration.count() / (dataPoint.hitCount * 1000));
-			fonsDrawText(fontStash.get(), dx, dy, text, nullptr);
+			SubmitText(RenderLayer::Profiler, windowWidth, windowHeight, dx, dy, text);
 			dy += 20.0f;
 		}
 	}
 
+	// the gpu's blocks come from the last frame that it has finished, a few frames behind the cpu's
+	const auto& gpuFrame = GPUProfilerGetLastFrame();
+	for (const auto& dataPoint : gpuFrame.statistics)
+	{
+		char text[255];
+		_snprintf_s(text, 255, "gpu %-36s %9lldus %8d %9lldus", dataPoint.id, dataPoint.duration.count() / 1000, dataPoint.hitCount, dataPoint.duration.count() / (dataPoint.hitCount * 1000));
+		SubmitText(RenderLayer::Profiler, windowWidth, windowHeight, dx, dy, text);
+		dy += 20.0f;
+	}
+	if (!gpuFrame.statistics.empty())
+	{
+		char text[255];
+		_snprintf_s(text, 255, "GPU timings from %d frames ago", gpuFrame.latency);
+		SubmitText(RenderLayer::Profiler, windowWidth, windowHeight, dx, dy, text);
+		dy += 20.0f;
+	}
+
+	{
+		const auto& aiStatistics = snapshot.aiStatistics;
+		char text[255];
+		_snprintf_s(text, 255, "AI active %d, updated %d, LOD skipped %d, deferred %d, timed %d (%d pending), behaviours %d (%d running), %dus of %dus budget", aiStatistics.active, aiStatistics.updated, aiStatistics.skippedByLevelOfDetail, aiStatistics.deferredByBudget, aiStatistics.timedActionsExecuted, aiStatistics.timedActionsPending, aiStatistics.behavioursResumed, aiStatistics.behavioursRunning, aiStatistics.elapsedMicroseconds, aiStatistics.budgetMicroseconds);
+		SubmitText(RenderLayer::Profiler, windowWidth, windowHeight, dx, dy, text);
+		dy += 20.0f;
+
+		const auto& spawnStatistics = snapshot.spawnStatistics;
+		_snprintf_s(text, 255, "Chunks %d of %d active, %d active objects", snapshot.activeChunkCount, snapshot.chunkCount, snapshot.activeObjectCount);
+		SubmitText(RenderLayer::Profiler, windowWidth, windowHeight, dx, dy, text);
+		dy += 20.0f;
+
+		_snprintf_s(text, 255, "Spawns %d, %d candidates checked, %d skipped without a free candidate", spawnStatistics.spawns, spawnStatistics.candidatesChecked, spawnStatistics.skipped);
+		SubmitText(RenderLayer::Profiler, windowWidth, windowHeight, dx, dy, text);
+		dy += 20.0f;
+
+		// live / spawned per type, so frame time can be read against the population
+		size_t length = snprintf(text, sizeof(text), "Live");
+		for (size_t typeIndex = 0; (typeIndex < static_cast<size_t>(GameObjectType::Count)) && (length < sizeof(text)); ++typeIndex)
+		{
+			const auto type = static_cast<GameObjectType>(typeIndex);
+			const auto& typeStatistics = snapshot.typeStatistics[typeIndex];
+			length += snprintf(text + length, sizeof(text) - length, " %s %d/%d", GetGameObjectMetaData(type).name, typeStatistics.live, typeStatistics.spawned);
+		}
+		SubmitText(RenderLayer::Profiler, windowWidth, windowHeight, dx, dy, text);
+		dy += 20.0f;
+
+		_snprintf_s(text, 255, "Live aliens %d, player bullets %d, alien bullets %d", snapshot.liveAlienCount, snapshot.livePlayerBulletCount, snapshot.liveAlienBulletCount);
+		SubmitText(RenderLayer::Profiler, windowWidth, windowHeight, dx, dy, text);
+		dy += 20.0f;
+
+		_snprintf_s(text, 255, "Sprites %d drawn, %d culled", static_cast<int>(snapshot.sprites.size()), snapshot.culledSpriteCount);
+		SubmitText(RenderLayer::Profiler, windowWidth, windowHeight, dx, dy, text);
+		dy += 20.0f;
+
+		const auto& glStateStatistics = GetGLStateCacheStatistics();
+		_snprintf_s(text, 255, "GL state calls %d issued, %d elided", glStateStatistics.issued, glStateStatistics.elided);
+		SubmitText(RenderLayer::Profiler, windowWidth, windowHeight, dx, dy, text);
+		dy += 20.0f;
+
+		const auto& renderQueueStatistics = renderQueue.statistics;
+		_snprintf_s(text, 255, "Render packets %d, %d setups", renderQueueStatistics.packets, renderQueueStatistics.setups);
+		SubmitText(RenderLayer::Profiler, windowWidth, windowHeight, dx, dy, text);
+		dy += 20.0f;
+	}
+
 	if (renderingMode == ProfilerRenderingMode::FrameTotals)
 	{
 		// 200px high = 1/30s
 		float graphHeight = 200.0f;
 		float performanceGraphScale = graphHeight * 1e-6f / 30.0f; // scale in pixels per ns
 
-		DebugDrawLine(Vector2 { -windowWidth / 2.0f, graphHeight - windowHeight / 2.0f }, Vector2 { windowWidth / 2.0f, graphHeight - windowHeight / 2.0f }, Color::Red);
+		DebugDrawOverlayLine(Vector2 { -windowWidth / 2.0f, graphHeight - windowHeight / 2.0f }, Vector2 { windowWidth / 2.0f, graphHeight - windowHeight / 2.0f }, Color::Red);
 
 		float graphBarWidth = 20.0f;
 		int graphHistorySize = windowWidth / static_cast<int>(graphBarWidth);
@@ -353,7 +565,7 @@ void RenderProfiler(const Time& /*time*/, int windowWidth, int windowHeight, Pro
 			float y = -windowHeight / 2.0f;
 			float w = graphBarWidth;
 			float h = performanceGraphScale * frameTime;
-			DebugDrawBox2d(Vector2 { x, y }, Vector2 { x + w, y + h }, Color::Cyan);
+			DebugDrawOverlayBox2d(Vector2 { x, y }, Vector2 { x + w, y + h }, Color::Cyan);
 		}
 	}
 	else
@@ -392,7 +604,7 @@ void RenderProfiler(const Time& /*time*/, int windowWidth, int windowHeight, Pro
 				if (rowIter == cend(threadRows))
 				{
 					threadRows.push_back(endEvent.threadId);
-					rowIndex = threadRows.size();
+					rowIndex = threadRows.size() - 1;
 				}
 				else
 				{
@@ -406,10 +618,21 @@ void RenderProfiler(const Time& /*time*/, int windowWidth, int windowHeight, Pro
 				float y = graphMaxY - rowIndex * barHeight * 1.2f;
 				float w = performanceGraphScale * duration;
 				float h = barHeight;
-				DebugDrawBox2d(Vector2 { x, y }, Vector2 { x + w, y + h }, Color::Cyan);
+				DebugDrawOverlayBox2d(Vector2 { x, y }, Vector2 { x + w, y + h }, Color::Cyan);
 
 				activeEvents.erase(beginEventIter);
 			}
 		}
+
+		// the gpu's blocks below the threads, a row for each level of nesting, placed by when the cpu began their frame
+		const size_t gpuRowIndex = threadRows.size() + 1;
+		for (const auto& timing : GPUProfilerGetLastFrame().timings)
+		{
+			float x = graphMinX + performanceGraphScale * static_cast<float>(timing.begin.count());
+			float y = graphMaxY - (gpuRowIndex + timing.depth) * barHeight * 1.2f;
+			float w = performanceGraphScale * static_cast<float>(timing.duration.count());
+			float h = barHeight;
+			DebugDrawOverlayBox2d(Vector2 { x, y }, Vector2 { x + w, y + h }, Color::Orange);
+		}
 	}
 }
\ No newline at end of file
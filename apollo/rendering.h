@@ -2,6 +2,12 @@
 
 #include "game.h"
 
+struct CameraView;
+struct RenderQueue;
+struct RenderSnapshot;
+struct SpriteAtlas;
+struct World;
+
 // using Color = uint32_t;
 enum class Color : uint32_t
 {
@@ -22,12 +28,21 @@ enum class Color : uint32_t
 
 
 bool LoadResources();
-void RenderWorld(const Time& time, int windowWidth, int windowHeight);
-void RenderUI(const Time& time, int windowWidth, int windowHeight);
+void UnloadResources(); // while the gl context is still current
+const SpriteAtlas& GetSpriteAtlas();
+
+// the render functions submit their draws to the queue, which main executes once the frame is submitted
+RenderQueue& GetRenderQueue();
+
+// called by the simulation thread at the end of its frame, the other functions only draw what it captured
+void CaptureRenderSnapshot(const World& world, const Time& time, const CameraView& cameraView, RenderSnapshot& snapshot);
+
+void RenderWorld(const RenderSnapshot& snapshot, int windowWidth, int windowHeight);
+void RenderUI(const RenderSnapshot& snapshot, int windowWidth, int windowHeight);
 void RenderDebugUI(const Time& time, int windowWidth, int windowHeight);
 
 enum class ProfilerRenderingMode { FrameTotals, FrameThreads };
-void RenderProfiler(const Time& time, int windowWidth, int windowHeight, ProfilerRenderingMode renderingMode);
+void RenderProfiler(const RenderSnapshot& snapshot, int windowWidth, int windowHeight, ProfilerRenderingMode renderingMode);
 
 
 
@@ -0,0 +1,302 @@
+#include "spawn_placement.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+#include "physics.h"
+#include "profiler.h"
+#include "world.h"
+
+using namespace std;
+
+namespace
+{
+	// keep the existing spawning rules: away from other objects, away from the player and away from the world edge
+	const float minSpawnSeparation = 50.0f;
+	const float minSpawnDistanceFromPlayer = 100.0f;
+	const float spawnBorder = 40.0f;
+
+	// the most candidates that a single spawn will examine before giving up on finding a free one
+	const int maxSpawnCandidateChecks = 64;
+
+	const float occupancyCellSize = 25.0f;
+
+
+	int GetRandomIndex(World& world, size_t count)
+	{
+		return min(static_cast<int>(GetRandomFloat01(world.random) * count), static_cast<int>(count) - 1);
+	}
+
+	void MarkSpawnOccupancy(SpawnOccupancyGrid& grid, const Vector2& position)
+	{
+		const int minX = max(static_cast<int>(floor((position.x - minSpawnSeparation - grid.origin.x) / occupancyCellSize)), 0);
+		const int maxX = min(static_cast<int>(floor((position.x + minSpawnSeparation - grid.origin.x) / occupancyCellSize)), grid.width - 1);
+		const int minY = max(static_cast<int>(floor((position.y - minSpawnSeparation - grid.origin.y) / occupancyCellSize)), 0);
+		const int maxY = min(static_cast<int>(floor((position.y + minSpawnSeparation - grid.origin.y) / occupancyCellSize)), grid.height - 1);
+		for (int y = minY; y <= maxY; ++y)
+		{
+			for (int x = minX; x <= maxX; ++x)
+			{
+				// distance from the position to the nearest point of the cell
+				Vector2 cellMin = grid.origin + occupancyCellSize * Vector2 { static_cast<float>(x), static_cast<float>(y) };
+				Vector2 nearest { min(max(position.x, cellMin.x), cellMin.x + occupancyCellSize), min(max(position.y, cellMin.y), cellMin.y + occupancyCellSize) };
+				if (glm::distance(nearest, position) < minSpawnSeparation)
+					grid.cells[y * grid.width + x] = 1;
+			}
+		}
+	}
+
+	bool IsSpawnPositionOccupied(const SpawnOccupancyGrid& grid, const Vector2& position)
+	{
+		const int x = static_cast<int>(floor((position.x - grid.origin.x) / occupancyCellSize));
+		const int y = static_cast<int>(floor((position.y - grid.origin.y) / occupancyCellSize));
+		if ((x < 0) || (x >= grid.width) || (y < 0) || (y >= grid.height))
+			return true;
+		return grid.cells[y * grid.width + x] != 0;
+	}
+
+	void BuildSpawnOccupancyGrid(World& world)
+	{
+		PROFILER_TIMER_FUNCTION();
+
+		const Vector2& minWorld = world.minWorld;
+		const Vector2& maxWorld = world.maxWorld;
+		auto& spawnPlacement = world.spawnPlacement;
+		auto& grid = spawnPlacement.occupancyGrid;
+		grid.origin = minWorld;
+		grid.maxWorld = maxWorld;
+		grid.width = max(1, static_cast<int>(ceil((maxWorld.x - minWorld.x) / occupancyCellSize)));
+		grid.height = max(1, static_cast<int>(ceil((maxWorld.y - minWorld.y) / occupancyCellSize)));
+		grid.cells.assign(grid.width * grid.height, 0);
+
+		for (const auto& collisionObject : world.collisionObjects)
+		{
+			if (collisionObject.layer != CollisionLayer::PendingDestruction)
+				MarkSpawnOccupancy(grid, collisionObject.position);
+		}
+		grid.isValid = true;
+
+		// every candidate is worth trying again against the new grid
+		auto& worldCandidates = spawnPlacement.worldCandidates;
+		auto& wallCandidates = spawnPlacement.wallCandidates;
+		worldCandidates.freeCount = worldCandidates.coords.size() / worldCandidates.stride;
+		wallCandidates.freeCount = wallCandidates.coords.size() / wallCandidates.stride;
+	}
+
+	// Bridson's Poisson-disk sampling of the spawnable area, no two candidates are closer than minSpawnSeparation
+	void GenerateWorldSpawnCandidates(World& world)
+	{
+		PROFILER_TIMER_FUNCTION();
+
+		const Vector2& minWorld = world.minWorld;
+		const Vector2& maxWorld = world.maxWorld;
+		auto& candidates = world.spawnPlacement.worldCandidates;
+		candidates.coords.clear();
+		candidates.stride = 2;
+		candidates.minWorld = minWorld;
+		candidates.maxWorld = maxWorld;
+
+		const Vector2 boxMin = minWorld + Vector2 { spawnBorder, spawnBorder };
+		const Vector2 boxMax = maxWorld - Vector2 { spawnBorder, spawnBorder };
+		if ((boxMin.x >= boxMax.x) || (boxMin.y >= boxMax.y))
+		{
+			candidates.freeCount = 0;
+			return;
+		}
+
+		const float cellSize = minSpawnSeparation / sqrt(2.0f);
+		const int width = static_cast<int>(ceil((boxMax.x - boxMin.x) / cellSize));
+		const int height = static_cast<int>(ceil((boxMax.y - boxMin.y) / cellSize));
+		vector<int> cells(width * height, -1);
+		vector<int> active;
+		const int attemptsPerSample = 30;
+
+		auto addSample = [&] (const Vector2& sample) {
+			int sampleIndex = static_cast<int>(candidates.coords.size() / 2);
+			candidates.coords.push_back(sample.x);
+			candidates.coords.push_back(sample.y);
+			int x = min(static_cast<int>((sample.x - boxMin.x) / cellSize), width - 1);
+			int y = min(static_cast<int>((sample.y - boxMin.y) / cellSize), height - 1);
+			cells[y * width + x] = sampleIndex;
+			active.push_back(sampleIndex);
+		};
+
+		auto isFarEnough = [&] (const Vector2& sample) {
+			int sampleX = static_cast<int>((sample.x - boxMin.x) / cellSize);
+			int sampleY = static_cast<int>((sample.y - boxMin.y) / cellSize);
+			for (int y = max(sampleY - 2, 0); y <= min(sampleY + 2, height - 1); ++y)
+			{
+				for (int x = max(sampleX - 2, 0); x <= min(sampleX + 2, width - 1); ++x)
+				{
+					int otherIndex = cells[y * width + x];
+					if ((otherIndex >= 0) && (glm::distance(sample, Vector2 { candidates.coords[otherIndex * 2], candidates.coords[otherIndex * 2 + 1] }) < minSpawnSeparation))
+						return false;
+				}
+			}
+			return true;
+		};
+
+		addSample(GetRandomVectorInBox(world.random, boxMin, boxMax));
+		while (!active.empty())
+		{
+			int activeIndex = GetRandomIndex(world, active.size());
+			int sampleIndex = active[activeIndex];
+			Vector2 sample { candidates.coords[sampleIndex * 2], candidates.coords[sampleIndex * 2 + 1] };
+
+			bool added = false;
+			for (int attempt = 0; attempt < attemptsPerSample; ++attempt)
+			{
+				Vector2 newSample = sample + minSpawnSeparation * (1.0f + GetRandomFloat01(world.random)) * GetRandomVectorOnCircle(world.random);
+				if ((newSample.x < boxMin.x) || (newSample.x >= boxMax.x) || (newSample.y < boxMin.y) || (newSample.y >= boxMax.y))
+					continue;
+				if (isFarEnough(newSample))
+				{
+					addSample(newSample);
+					added = true;
+					break;
+				}
+			}
+
+			if (!added)
+			{
+				active[activeIndex] = active.back();
+				active.pop_back();
+			}
+		}
+
+		candidates.freeCount = candidates.coords.size() / 2;
+	}
+
+	// the walls are treated as a single line (bottom, right, top, left), which is split into strata with one candidate each
+	void GenerateWallSpawnCandidates(World& world)
+	{
+		PROFILER_TIMER_FUNCTION();
+
+		const Vector2& minWorld = world.minWorld;
+		const Vector2& maxWorld = world.maxWorld;
+		auto& candidates = world.spawnPlacement.wallCandidates;
+		candidates.coords.clear();
+		candidates.stride = 1;
+		candidates.minWorld = minWorld;
+		candidates.maxWorld = maxWorld;
+
+		float wallWidth = maxWorld.x - minWorld.x;
+		float wallHeight = maxWorld.y - minWorld.y;
+		float wallLength = 2 * wallWidth + 2 * wallHeight;
+		int strataCount = max(1, static_cast<int>(wallLength / minSpawnSeparation));
+		float strataLength = wallLength / strataCount;
+		for (int i = 0; i < strataCount; ++i)
+		{
+			candidates.coords.push_back(min((i + GetRandomFloat01(world.random)) * strataLength, wallLength));
+		}
+
+		candidates.freeCount = candidates.coords.size();
+	}
+
+	bool IsSpawnPositionFree(const World& world, const Vector2& position)
+	{
+		return (glm::distance(GetRigidBody(world, world.player.objectId).position, position) > minSpawnDistanceFromPlayer) && !IsSpawnPositionOccupied(world.spawnPlacement.occupancyGrid, position);
+	}
+
+	// Draws candidates from the free set until one passes the test, moving the ones that fail out of the free set.
+	// Returns the index of the chosen candidate, or -1 if none were free within the bounded number of checks, in which
+	// case the spawn is skipped rather than placed on top of something.
+	template <typename GetCandidatePosition>
+	int ChooseSpawnCandidate(World& world, SpawnCandidates& candidates, GetCandidatePosition getCandidatePosition)
+	{
+		auto& spawnPlacementStatistics = world.spawnPlacement.statistics;
+
+		auto swapCandidates = [&candidates] (size_t a, size_t b) {
+			for (size_t i = 0; i < candidates.stride; ++i)
+				swap(candidates.coords[a * candidates.stride + i], candidates.coords[b * candidates.stride + i]);
+		};
+
+		++spawnPlacementStatistics.spawns;
+		if (candidates.freeCount == 0)
+		{
+			++spawnPlacementStatistics.skipped;
+			return -1;
+		}
+
+		for (int check = 0; (check < maxSpawnCandidateChecks) && (candidates.freeCount > 0); ++check)
+		{
+			++spawnPlacementStatistics.candidatesChecked;
+			size_t candidateIndex = GetRandomIndex(world, candidates.freeCount);
+			--candidates.freeCount;
+			swapCandidates(candidateIndex, candidates.freeCount);
+
+			Vector2 position = getCandidatePosition(candidates.freeCount);
+			if (IsSpawnPositionFree(world, position))
+			{
+				MarkSpawnOccupancy(world.spawnPlacement.occupancyGrid, position);
+				return static_cast<int>(candidates.freeCount);
+			}
+		}
+
+		++spawnPlacementStatistics.skipped;
+		return -1;
+	}
+
+	void PrepareSpawnCandidates(World& world, SpawnCandidates& candidates, void (*generateCandidates)(World&))
+	{
+		if ((candidates.minWorld != world.minWorld) || (candidates.maxWorld != world.maxWorld) || candidates.coords.empty())
+			generateCandidates(world);
+		// the world shrinks as the wall huggers build walls
+		const auto& grid = world.spawnPlacement.occupancyGrid;
+		if (!grid.isValid || (grid.origin != world.minWorld) || (grid.maxWorld != world.maxWorld))
+			BuildSpawnOccupancyGrid(world);
+	}
+}
+
+
+void InvalidateSpawnOccupancy(World& world)
+{
+	world.spawnPlacement.occupancyGrid.isValid = false;
+}
+
+
+bool FindSpawnPositionInWorld(World& world, Vector2& position, Vector2& facing)
+{
+	PROFILER_TIMER_FUNCTION();
+
+	auto& candidates = world.spawnPlacement.worldCandidates;
+	PrepareSpawnCandidates(world, candidates, GenerateWorldSpawnCandidates);
+
+	auto getCandidatePosition = [&candidates] (size_t candidateIndex) {
+		return Vector2 { candidates.coords[candidateIndex * 2], candidates.coords[candidateIndex * 2 + 1] };
+	};
+	int candidateIndex = ChooseSpawnCandidate(world, candidates, getCandidatePosition);
+	if (candidateIndex < 0)
+		return false;
+
+	position = getCandidatePosition(candidateIndex);
+	facing = GetRandomVectorOnCircle(world.random);
+	return true;
+}
+
+
+bool FindSpawnPositionAlongWall(World& world, const Vector2& collisionBoxDimensions, Vector2& position, Vector2& facing)
+{
+	PROFILER_TIMER_FUNCTION();
+
+	auto& candidates = world.spawnPlacement.wallCandidates;
+	PrepareSpawnCandidates(world, candidates, GenerateWallSpawnCandidates);
+
+	auto getCandidatePosition = [&world, &candidates, &collisionBoxDimensions] (size_t candidateIndex) {
+		return get<0>(GetPositionAndFacingFromWallCoord(world, candidates.coords[candidateIndex], collisionBoxDimensions));
+	};
+	int candidateIndex = ChooseSpawnCandidate(world, candidates, getCandidatePosition);
+	if (candidateIndex < 0)
+		return false;
+
+	tie(position, facing) = GetPositionAndFacingFromWallCoord(world, candidates.coords[candidateIndex], collisionBoxDimensions);
+	return true;
+}
+
+
+const SpawnPlacementStatistics& GetSpawnPlacementStatistics(const World& world)
+{
+	return world.spawnPlacement.statistics;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "math_helpers.h"
+
+struct World;
+
+
+// Aliens are spawned at positions drawn from a set of Poisson-disk sampled candidates, so that spawns are spread out,
+// and each candidate is tested against an occupancy grid of the collision objects rather than every collision object.
+// A spawn examines at most a fixed number of candidates, so placement takes bounded time however crowded the world is,
+// and a spawn that finds no free candidate within them is skipped.
+
+
+// a cell is occupied if any of it is closer than the minimum spawn separation to a collision object
+struct SpawnOccupancyGrid
+{
+	Vector2 origin { 0.0f, 0.0f };
+	Vector2 maxWorld { 0.0f, 0.0f };
+	int width { 0 };
+	int height { 0 };
+	std::vector<uint8_t> cells;
+	bool isValid { false };
+};
+
+// The candidates for one kind of spawn. Candidates in [0, freeCount) haven't been found to be occupied since the
+// occupancy grid was last built, the ones after that are skipped until it is rebuilt.
+struct SpawnCandidates
+{
+	std::vector<float> coords; // interleaved x, y for world candidates, a wall coord for wall candidates
+	size_t stride { 1 };
+	size_t freeCount { 0 };
+	Vector2 minWorld { 0.0f, 0.0f };
+	Vector2 maxWorld { 0.0f, 0.0f };
+};
+
+struct SpawnPlacementStatistics
+{
+	int spawns { 0 };
+	int candidatesChecked { 0 };
+	int skipped { 0 }; // spawns that found no free candidate and weren't placed
+};
+
+struct SpawnPlacement
+{
+	SpawnOccupancyGrid occupancyGrid;
+	SpawnCandidates worldCandidates;
+	SpawnCandidates wallCandidates;
+	SpawnPlacementStatistics statistics;
+};
+
+// the occupancy grid is rebuilt before the next spawn once the collision objects have moved
+void InvalidateSpawnOccupancy(World& world);
+
+// finds the position and facing for a new alien inside the world, returns false if there's no free position
+bool FindSpawnPositionInWorld(World& world, Vector2& position, Vector2& facing);
+
+// finds the position and facing for a new alien on the edge of the world, facing inwards, returns false if there's no
+// free position
+bool FindSpawnPositionAlongWall(World& world, const Vector2& collisionBoxDimensions, Vector2& position, Vector2& facing);
+
+const SpawnPlacementStatistics& GetSpawnPlacementStatistics(const World& world);
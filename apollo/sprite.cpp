@@ -1,5 +1,7 @@
-#include "Sprite.h"
+#include "sprite.h"
 
+#include <algorithm>
+#include <cassert>
 #include <memory>
 #include <future>
 
@@ -29,13 +31,6 @@ SpriteShader CreateSpriteShader(const std::string& vertexShaderFilename, const s
 		CheckOpenGLErrors();
 	}
 
-	spriteShader.modelviewUniform = glGetUniformLocation(spriteShader.program, "u_modelview");
-	if (spriteShader.modelviewUniform == -1)
-	{
-		printf("Unable to find uniform u_modelview in player shader.\n");
-		CheckOpenGLErrors();
-	}
-
 	spriteShader.projectionUniform = glGetUniformLocation(spriteShader.program, "u_projection");
 	if (spriteShader.projectionUniform == -1)
 	{
@@ -47,107 +42,212 @@ SpriteShader CreateSpriteShader(const std::string& vertexShaderFilename, const s
 }
 
 
-Sprite CreateSprite(const std::string& spriteFilename)
+namespace
+{
+	struct SpriteImage
+	{
+		int w { 0 };
+		int h { 0 };
+		std::unique_ptr<uint8_t, void(*)(void*)> pixels { nullptr, stbi_image_free };
+		int x { 0 }; // position in the atlas
+		int y { 0 };
+	};
+
+	// shelf packs the images, tallest first, into rows of the given width and returns the height used
+	int PackSpriteImages(vector<SpriteImage*>& sortedImages, int atlasWidth)
+	{
+		constexpr int padding = 1; // keep the neighbouring sprites from bleeding into each other
+
+		int x = 0;
+		int y = 0;
+		int shelfHeight = 0;
+		for (auto* image : sortedImages)
+		{
+			if ((x > 0) && (x + image->w > atlasWidth))
+			{
+				x = 0;
+				y += shelfHeight + padding;
+				shelfHeight = 0;
+			}
+			image->x = x;
+			image->y = y;
+			x += image->w + padding;
+			shelfHeight = max(shelfHeight, image->h);
+		}
+		return y + shelfHeight;
+	}
+
+	int NextPowerOfTwo(int value)
+	{
+		int powerOfTwo = 1;
+		while (powerOfTwo < value)
+			powerOfTwo *= 2;
+		return powerOfTwo;
+	}
+
+	// tries each power of two width and keeps the packing with the smallest power of two texture
+	void PackSpriteImages(vector<SpriteImage>& images, int& atlasWidth, int& atlasHeight)
+	{
+		vector<SpriteImage*> sortedImages;
+		int minWidth = 1;
+		for (auto& image : images)
+		{
+			sortedImages.push_back(&image);
+			minWidth = max(minWidth, image.w);
+		}
+		sort(begin(sortedImages), end(sortedImages), [] (const SpriteImage* a, const SpriteImage* b) { return a->h > b->h; });
+
+		atlasWidth = 0;
+		atlasHeight = 0;
+		for (int width = NextPowerOfTwo(minWidth); width <= 4096; width *= 2)
+		{
+			const int height = NextPowerOfTwo(PackSpriteImages(sortedImages, width));
+			if ((atlasWidth == 0) || (width * height < atlasWidth * atlasHeight))
+			{
+				atlasWidth = width;
+				atlasHeight = height;
+			}
+		}
+		PackSpriteImages(sortedImages, atlasWidth);
+	}
+}
+
+
+SpriteAtlas CreateSpriteAtlas(const std::vector<std::string>& spriteFilenames)
 {
-	Sprite sprite;
+	SpriteAtlas spriteAtlas;
 
-	int w = 0;
-	int h = 0;
-	auto pixels = std::unique_ptr<uint8_t, void(*)(void*)>(stbi_load(spriteFilename.c_str(), &w, &h, 0, 4), stbi_image_free);
-	if (!pixels)
+	vector<SpriteImage> images(spriteFilenames.size());
+	for (size_t i = 0; i < spriteFilenames.size(); ++i)
 	{
-		printf("Unable to load the image from %s\n", spriteFilename.c_str());
-		return sprite;
+		auto& image = images[i];
+		image.pixels.reset(stbi_load(spriteFilenames[i].c_str(), &image.w, &image.h, 0, 4));
+		if (!image.pixels)
+		{
+			printf("Unable to load the image from %s\n", spriteFilenames[i].c_str());
+			return spriteAtlas;
+		}
 	}
 
-	sprite.dimensions = Vector2(w, h);
-	glGenTextures(1, &sprite.texture);
-	glBindTexture(GL_TEXTURE_2D, sprite.texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.get());
-	glGenerateMipmap(GL_TEXTURE_2D);
+	int atlasWidth = 0;
+	int atlasHeight = 0;
+	PackSpriteImages(images, atlasWidth, atlasHeight);
+	vector<uint8_t> atlasPixels(atlasWidth * atlasHeight * 4, 0);
+	for (const auto& image : images)
+	{
+		for (int row = 0; row < image.h; ++row)
+			copy_n(image.pixels.get() + row * image.w * 4, image.w * 4, atlasPixels.data() + ((image.y + row) * atlasWidth + image.x) * 4);
+	}
+
+	spriteAtlas.dimensions = Vector2(atlasWidth, atlasHeight);
+	spriteAtlas.spriteFilenames = spriteFilenames;
+	for (const auto& image : images)
+	{
+		Sprite sprite;
+		sprite.dimensions = Vector2(image.w, image.h);
+		sprite.uvMin = Vector2(image.x, image.y) / spriteAtlas.dimensions;
+		sprite.uvMax = Vector2(image.x + image.w, image.y + image.h) / spriteAtlas.dimensions;
+		sprite.uvRect[0] = static_cast<uint16_t>(sprite.uvMin.x * 65535.0f + 0.5f);
+		sprite.uvRect[1] = static_cast<uint16_t>(sprite.uvMin.y * 65535.0f + 0.5f);
+		sprite.uvRect[2] = static_cast<uint16_t>(sprite.uvMax.x * 65535.0f + 0.5f);
+		sprite.uvRect[3] = static_cast<uint16_t>(sprite.uvMax.y * 65535.0f + 0.5f);
+		spriteAtlas.sprites.push_back(sprite);
+	}
+
+	// no mipmaps, the smaller levels would blend the neighbouring sprites together
+	glGenTextures(1, &spriteAtlas.texture);
+	glBindTexture(GL_TEXTURE_2D, spriteAtlas.texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, atlasWidth, atlasHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, atlasPixels.data());
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	glBindTexture(GL_TEXTURE_2D, 0);
 
 
-	glGenBuffers(1, &sprite.vertexBuffer);
-	if (sprite.vertexBuffer == 0)
+	// every sprite is drawn with the same unit quad, scaled to its dimensions and mapped to its region of the atlas
+	glGenBuffers(1, &spriteAtlas.vertexBuffer);
+	if (spriteAtlas.vertexBuffer == 0)
 	{
 		printf("Unable to allocate sprite vertex buffer: %s\n", glewGetErrorString(glGetError()));
-		return Sprite {};
+		return SpriteAtlas {};
 	}
-	float minX = -w / 2.0f;
-	float maxX = w / 2.0f;
-	float minY = -h / 2.0f;
-	float maxY = h / 2.0f;
 	position_uv_vertex vertices[]
-	{ { { minX, minY, 0.0f }, { 0.0f, 1.0f } },
-	{ { maxX, minY, 0.0f }, { 1.0f, 1.0f } },
-	{ { maxX, maxY, 0.0f }, { 1.0f, 0.0f } },
-	{ { minX, maxY, 0.0f }, { 0.0f, 0.0f } } };
-	sprite.vertexCount = sizeof(vertices) / sizeof(position_uv_vertex);
-	glBindBuffer(GL_ARRAY_BUFFER, sprite.vertexBuffer);
-	glBufferData(GL_ARRAY_BUFFER, sprite.vertexCount * sizeof(position_uv_vertex), vertices, GL_STATIC_DRAW);
+	{ { { -0.5f, -0.5f, 0.0f }, { 0.0f, 1.0f } },
+	{ { 0.5f, -0.5f, 0.0f }, { 1.0f, 1.0f } },
+	{ { 0.5f, 0.5f, 0.0f }, { 1.0f, 0.0f } },
+	{ { -0.5f, 0.5f, 0.0f }, { 0.0f, 0.0f } } };
+	spriteAtlas.vertexCount = sizeof(vertices) / sizeof(position_uv_vertex);
+	glBindBuffer(GL_ARRAY_BUFFER, spriteAtlas.vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, spriteAtlas.vertexCount * sizeof(position_uv_vertex), vertices, GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
 
-	glGenBuffers(1, &sprite.indexBuffer);
-	if (sprite.indexBuffer == 0)
+	glGenBuffers(1, &spriteAtlas.indexBuffer);
+	if (spriteAtlas.indexBuffer == 0)
 	{
 		printf("Unable to allocate sprite index buffer: %s\n", glewGetErrorString(glGetError()));
-		return Sprite {};
+		return SpriteAtlas {};
 	}
 	GLushort indices[] { 0, 1, 3, 3, 1, 2 };
-	sprite.indexCount = sizeof(indices) / sizeof(GLushort);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sprite.indexBuffer);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sprite.indexCount * sizeof(GLushort), indices, GL_STATIC_DRAW);
+	spriteAtlas.indexCount = sizeof(indices) / sizeof(GLushort);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, spriteAtlas.indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, spriteAtlas.indexCount * sizeof(GLushort), indices, GL_STATIC_DRAW);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
 	CheckOpenGLErrors();
 
-	return sprite;
+	return spriteAtlas;
 }
 
 
-void DrawSprite(const Sprite& sprite, const SpriteShader& spriteShader, const glm::mat4& modelviewMatrix, const glm::mat4& projectionMatrix)
+const Sprite& GetSprite(const SpriteAtlas& spriteAtlas, const std::string& spriteFilename)
 {
-	glBindBuffer(GL_ARRAY_BUFFER, sprite.vertexBuffer);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sprite.indexBuffer);
+	auto iter = find(begin(spriteAtlas.spriteFilenames), end(spriteAtlas.spriteFilenames), spriteFilename);
+	assert(iter != end(spriteAtlas.spriteFilenames));
+	return spriteAtlas.sprites[distance(begin(spriteAtlas.spriteFilenames), iter)];
+}
 
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(position_uv_vertex), (void*)offsetof(position_uv_vertex, position));
 
-	glEnableVertexAttribArray(1);
+void AddSpriteInstance(std::vector<SpriteInstance>& spriteInstances, const Sprite& sprite, const Vector2& position, const Vector2& facing)
+{
+	spriteInstances.push_back(SpriteInstance { position, facing, sprite.dimensions, { sprite.uvRect[0], sprite.uvRect[1], sprite.uvRect[2], sprite.uvRect[3] } });
+}
+
+
+void DrawSpriteInstances(const std::vector<SpriteInstance>& spriteInstances, GLStreamBuffer& instanceBuffer, const SpriteAtlas& spriteAtlas, const SpriteShader& spriteShader, const glm::mat4& projectionMatrix)
+{
+	if (spriteInstances.empty())
+		return;
+
+	const auto instanceDataSize = static_cast<GLsizeiptr>(spriteInstances.size() * sizeof(SpriteInstance));
+	const auto instanceOffset = instanceBuffer.Write(spriteInstances.data(), instanceDataSize);
+	if (instanceBuffer == 0)
+		return;
+
+	CachedUseProgram(spriteShader.program);
+	CachedSetVertexAttribArrays(0x1f);
+
+	// all of the instance attributes advance once per instance
+	glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)(instanceOffset + offsetof(SpriteInstance, position)));
+	CachedVertexAttribDivisor(2, 1);
+	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)(instanceOffset + offsetof(SpriteInstance, dimensions)));
+	CachedVertexAttribDivisor(3, 1);
+	glVertexAttribPointer(4, 4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(SpriteInstance), (void*)(instanceOffset + offsetof(SpriteInstance, uvRect)));
+	CachedVertexAttribDivisor(4, 1);
+
+	CachedBindBuffer(GL_ARRAY_BUFFER, spriteAtlas.vertexBuffer);
+	CachedBindBuffer(GL_ELEMENT_ARRAY_BUFFER, spriteAtlas.indexBuffer);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(position_uv_vertex), (void*)offsetof(position_uv_vertex, position));
+	CachedVertexAttribDivisor(0, 0);
 	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(position_uv_vertex), (void*)offsetof(position_uv_vertex, uv));
+	CachedVertexAttribDivisor(1, 0);
 
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, sprite.texture);
-	glUniform1i(spriteShader.texUniform, 0);
-	glUniformMatrix4fv(spriteShader.modelviewUniform, 1, GL_FALSE, glm::value_ptr(modelviewMatrix));
+	CachedBindTexture(0, spriteAtlas.texture);
+	CachedUniform1i(spriteShader.texUniform, 0);
 	glUniformMatrix4fv(spriteShader.projectionUniform, 1, GL_FALSE, glm::value_ptr(projectionMatrix));
 
-	glDrawElements(GL_TRIANGLES, sprite.indexCount, GL_UNSIGNED_SHORT, 0);
-
-	glDisableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	glDrawElementsInstanced(GL_TRIANGLES, spriteAtlas.indexCount, GL_UNSIGNED_SHORT, 0, static_cast<GLsizei>(spriteInstances.size()));
 
 	CheckOpenGLErrors();
 }
-
-glm::mat4 CreateSpriteModelviewMatrix(const Sprite& /*sprite*/, const Vector3& position, const Vector3& facing)
-{
-	return CalculateObjectTransform(position, facing);
-}
-
-glm::mat4 CreateSpriteModelviewMatrix(const Sprite& /*sprite*/, const Vector2& position, const Vector2& facing)
-{
-	return CalculateObjectTransform(position, facing);
-}
-
-glm::mat4 CreateSpriteBottomLeftModelviewMatrix(const Sprite& sprite, const Vector3& position, const Vector3& facing)
-{
-	return CreateSpriteModelviewMatrix(sprite, position - facing / 2.0f, facing);
-}
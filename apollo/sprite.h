@@ -1,34 +1,57 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include "glm/glm.hpp"
 #include "gl_helpers.h"
 #include "math_helpers.h"
 
+// the sprite shader builds each sprite's transform from its position and facing in the per instance attributes
 struct SpriteShader
 {
 	GLProgram program {};
 	GLint texUniform;
-	GLint modelviewUniform;
 	GLint projectionUniform;
 };
 
 SpriteShader CreateSpriteShader(const std::string& vertexShaderFilename, const std::string& pixelShaderFilename);
 
+// a region of the sprite atlas, in pixels and in texture coordinates
 struct Sprite
 {
 	Vector2 dimensions { 0.0f, 0.0f };
+	Vector2 uvMin { 0.0f, 0.0f };
+	Vector2 uvMax { 0.0f, 0.0f };
+	uint16_t uvRect[4] {}; // uvMin and uvMax as normalized shorts, as the sprite instances store them
+};
+
+// all of the sprite images packed into one texture, drawn with a shared unit quad
+struct SpriteAtlas
+{
 	GLuint texture { 0 };
+	Vector2 dimensions { 0.0f, 0.0f };
+	std::vector<std::string> spriteFilenames;
+	std::vector<Sprite> sprites;
 	GLuint vertexBuffer { 0 };
 	GLuint vertexCount { 0 };
 	GLuint indexBuffer { 0 };
 	GLuint indexCount { 0 };
 };
 
-Sprite CreateSprite(const std::string& spriteFilename);
-void DrawSprite(const Sprite& sprite, const SpriteShader& spriteShader, const glm::mat4& modelviewMatrix, const glm::mat4& projectionMatrix);
+SpriteAtlas CreateSpriteAtlas(const std::vector<std::string>& spriteFilenames);
+const Sprite& GetSprite(const SpriteAtlas& spriteAtlas, const std::string& spriteFilename);
+
+// eight words per sprite, the transform is built in the vertex shader the same way as CalculateObjectTransform
+struct SpriteInstance
+{
+	Vector2 position;
+	Vector2 facing;
+	Vector2 dimensions;
+	uint16_t uvRect[4];
+};
+static_assert(sizeof(SpriteInstance) == 32, "SpriteInstance should be eight words");
 
-glm::mat4 CreateSpriteModelviewMatrix(const Sprite& sprite, const Vector3& position, const Vector3& facing);
-glm::mat4 CreateSpriteModelviewMatrix(const Sprite& sprite, const Vector2& position, const Vector2& facing);
-glm::mat4 CreateSpriteBottomLeftModelviewMatrix(const Sprite& sprite, const Vector3& position, const Vector3& facing);
+void AddSpriteInstance(std::vector<SpriteInstance>& spriteInstances, const Sprite& sprite, const Vector2& position, const Vector2& facing);
 
+// uploads the sprites, in order, to the instance buffer and draws them all with a single instanced draw
+void DrawSpriteInstances(const std::vector<SpriteInstance>& spriteInstances, GLStreamBuffer& instanceBuffer, const SpriteAtlas& spriteAtlas, const SpriteShader& spriteShader, const glm::mat4& projectionMatrix);
@@ -1,11 +1,18 @@
 #version 300 es
 layout(location = 0) in vec4 a_position;
 layout(location = 1) in vec2 a_texcoord;
+layout(location = 2) in vec4 a_positionFacing; // per instance, the position in xy and the facing in zw
+layout(location = 3) in vec2 a_dimensions; // per instance
+layout(location = 4) in vec4 a_uvRect; // per instance, the min and max texture coordinates of the sprite in the atlas
 out vec2 v_texCoord;
-uniform mat4 u_modelview;
 uniform mat4 u_projection;
 void main()
 {
-	gl_Position = u_projection * u_modelview * a_position;
-	v_texCoord = a_texcoord;
+	// the same transform as CalculateObjectTransform, the facing is the y axis and the x axis is to its right
+	vec2 facing = a_positionFacing.zw;
+	vec2 right = vec2(facing.y, -facing.x);
+	vec2 local = a_position.xy * a_dimensions;
+	vec2 position = a_positionFacing.xy + local.x * right + local.y * facing;
+	gl_Position = u_projection * vec4(position, a_position.z, 1.0);
+	v_texCoord = mix(a_uvRect.xy, a_uvRect.zw, a_texcoord);
 }
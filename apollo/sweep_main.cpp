@@ -0,0 +1,429 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+using namespace std;
+
+
+// Runs apollo_headless over a grid or a random sample of tweakable values, several runs at a time, and collects the
+// score, time to clear and frame cost of every run into a CSV and/or JSON report. Tweakables are process wide globals,
+// so each run is a process of its own with its values passed as --set options.
+
+namespace
+{
+	struct SweepParameter
+	{
+		string name;
+		vector<string> values; // a list of values, or empty for a range
+		double rangeMin { 0.0 };
+		double rangeMax { 0.0 };
+		bool isIntegerRange { false };
+	};
+
+	struct SweepOptions
+	{
+		string runnerPath;
+		vector<SweepParameter> parameters;
+		int ticks { 3600 };
+		float deltaTime { 1.0f / 60.0f };
+		int seeds { 1 };
+		int samples { 0 }; // 0 sweeps the grid
+		int steps { 5 }; // values a range is split into for the grid
+		uint64_t sampleSeed { 1 };
+		int jobs { 0 };
+		int aiUpdateBudgetMicroseconds { 0 }; // 0 keeps the runs repeatable
+		const char* csvFilename { nullptr };
+		const char* jsonFilename { nullptr };
+	};
+
+	struct SweepRun
+	{
+		vector<string> values; // one per parameter
+		uint64_t seed { 0 };
+	};
+
+	struct SweepResult
+	{
+		bool succeeded { false };
+		int ticks { 0 };
+		double seconds { 0.0 };
+		int score { 0 };
+		int liveAliens { 0 };
+		int spawnedAliens { 0 };
+		int gameOverTick { -1 };
+	};
+
+
+	void PrintUsage()
+	{
+		printf("usage: apollo_sweep [options] --param NAME=VALUES...\n");
+		printf("  --param NAME=A,B,C  try each of the listed values, made of letters, digits and . _ + -\n");
+		printf("  --param NAME=MIN:MAX  a range, split into --steps values for the grid or sampled uniformly\n");
+		printf("  --samples N         run N random samples of the parameters instead of the full grid\n");
+		printf("  --steps N           values each range is split into for the grid (default 5)\n");
+		printf("  --sample-seed N     seed for picking the random samples (default 1)\n");
+		printf("  --seeds N           run every configuration with world seeds 1..N (default 1)\n");
+		printf("  --ticks N           ticks to run each simulation for, it stops early once cleared (default 3600)\n");
+		printf("  --dt SECONDS        fixed time step of the simulations (default 1/60)\n");
+		printf("  --jobs N            simulations to run at once (default one per core)\n");
+		printf("  --ai-budget MICROSECONDS  give the AI a wall clock budget, the runs are no longer repeatable\n");
+		printf("  --runner PATH       the headless runner (default apollo_headless next to this executable)\n");
+		printf("  --csv FILE          write the results as CSV\n");
+		printf("  --json FILE         write the results as JSON\n");
+		printf("the frame cost of runs sharing the cores is only comparable between runs of the same sweep, use --jobs 1 to measure it\n");
+	}
+
+	bool IsInteger(const string& value)
+	{
+		char* end = nullptr;
+		strtol(value.c_str(), &end, 10);
+		return !value.empty() && (*end == '\0');
+	}
+
+	// the names and values go to the runner through the shell, and into the reports, without quoting, so they are kept
+	// to the characters of tweakable names and numbers
+	bool IsPlainToken(const string& token)
+	{
+		return !token.empty() && all_of(begin(token), end(token), [] (char c)
+		{
+			return isalnum(static_cast<unsigned char>(c)) || (c == '.') || (c == '_') || (c == '+') || (c == '-');
+		});
+	}
+
+	bool ParseParameter(const string& assignment, SweepParameter& parameter)
+	{
+		const auto equals = assignment.find('=');
+		if ((equals == string::npos) || (equals == 0) || (equals + 1 == assignment.size()))
+			return false;
+
+		parameter.name = assignment.substr(0, equals);
+		if (!IsPlainToken(parameter.name))
+			return false;
+		const string values = assignment.substr(equals + 1);
+
+		const auto colon = values.find(':');
+		if (colon != string::npos)
+		{
+			const string minValue = values.substr(0, colon);
+			const string maxValue = values.substr(colon + 1);
+			char* minEnd = nullptr;
+			char* maxEnd = nullptr;
+			parameter.rangeMin = strtod(minValue.c_str(), &minEnd);
+			parameter.rangeMax = strtod(maxValue.c_str(), &maxEnd);
+			parameter.isIntegerRange = IsInteger(minValue) && IsInteger(maxValue);
+			return !minValue.empty() && !maxValue.empty() && (*minEnd == '\0') && (*maxEnd == '\0') && (parameter.rangeMin <= parameter.rangeMax);
+		}
+
+		size_t start = 0;
+		for (;;)
+		{
+			const auto comma = values.find(',', start);
+			parameter.values.push_back(values.substr(start, comma - start));
+			if (comma == string::npos)
+				break;
+			start = comma + 1;
+		}
+		return all_of(begin(parameter.values), end(parameter.values), IsPlainToken);
+	}
+
+	string FormatRangeValue(const SweepParameter& parameter, double value)
+	{
+		char buffer[32];
+		if (parameter.isIntegerRange)
+			snprintf(buffer, sizeof(buffer), "%d", static_cast<int>(lround(value)));
+		else
+			snprintf(buffer, sizeof(buffer), "%g", value);
+		return buffer;
+	}
+
+	string GetDefaultRunnerPath(const char* sweepPath)
+	{
+		string path = sweepPath;
+		const auto slash = path.find_last_of("/\\");
+		path = (slash == string::npos) ? string() : path.substr(0, slash + 1);
+#ifdef _WIN32
+		return path + "apollo_headless.exe";
+#else
+		return (path.empty() ? string("./") : path) + "apollo_headless";
+#endif
+	}
+
+	bool ParseOptions(int argc, char** argv, SweepOptions& options)
+	{
+		options.runnerPath = GetDefaultRunnerPath(argv[0]);
+		for (int i = 1; i < argc; ++i)
+		{
+			const char* arg = argv[i];
+			const bool hasValue = (i + 1 < argc);
+			if ((strcmp(arg, "--param") == 0) && hasValue)
+			{
+				SweepParameter parameter;
+				if (!ParseParameter(argv[++i], parameter))
+				{
+					printf("Unable to parse parameter: %s\n", argv[i]);
+					return false;
+				}
+				options.parameters.push_back(parameter);
+			}
+			else if ((strcmp(arg, "--samples") == 0) && hasValue)
+				options.samples = atoi(argv[++i]);
+			else if ((strcmp(arg, "--steps") == 0) && hasValue)
+				options.steps = atoi(argv[++i]);
+			else if ((strcmp(arg, "--sample-seed") == 0) && hasValue)
+				options.sampleSeed = strtoull(argv[++i], nullptr, 10);
+			else if ((strcmp(arg, "--seeds") == 0) && hasValue)
+				options.seeds = atoi(argv[++i]);
+			else if ((strcmp(arg, "--ticks") == 0) && hasValue)
+				options.ticks = atoi(argv[++i]);
+			else if ((strcmp(arg, "--dt") == 0) && hasValue)
+				options.deltaTime = strtof(argv[++i], nullptr);
+			else if ((strcmp(arg, "--jobs") == 0) && hasValue)
+				options.jobs = atoi(argv[++i]);
+			else if ((strcmp(arg, "--ai-budget") == 0) && hasValue)
+				options.aiUpdateBudgetMicroseconds = atoi(argv[++i]);
+			else if ((strcmp(arg, "--runner") == 0) && hasValue)
+				options.runnerPath = argv[++i];
+			else if ((strcmp(arg, "--csv") == 0) && hasValue)
+				options.csvFilename = argv[++i];
+			else if ((strcmp(arg, "--json") == 0) && hasValue)
+				options.jsonFilename = argv[++i];
+			else
+				return false;
+		}
+
+		if (options.jobs <= 0)
+			options.jobs = max(1, static_cast<int>(thread::hardware_concurrency()));
+		return !options.parameters.empty() && (options.ticks > 0) && (options.deltaTime > 0.0f) && (options.seeds > 0) && (options.samples >= 0) && (options.steps > 0);
+	}
+
+
+	vector<vector<string>> MakeGrid(const SweepOptions& options)
+	{
+		vector<vector<string>> configurations(1);
+		for (const auto& parameter : options.parameters)
+		{
+			vector<string> values = parameter.values;
+			if (values.empty())
+			{
+				for (int step = 0; step < options.steps; ++step)
+				{
+					const double t = (options.steps == 1) ? 0.0 : static_cast<double>(step) / (options.steps - 1);
+					auto value = FormatRangeValue(parameter, parameter.rangeMin + t * (parameter.rangeMax - parameter.rangeMin));
+					if (find(begin(values), end(values), value) == end(values))
+						values.push_back(value);
+				}
+			}
+
+			vector<vector<string>> expanded;
+			expanded.reserve(configurations.size() * values.size());
+			for (const auto& configuration : configurations)
+			{
+				for (const auto& value : values)
+				{
+					expanded.push_back(configuration);
+					expanded.back().push_back(value);
+				}
+			}
+			configurations = move(expanded);
+		}
+		return configurations;
+	}
+
+	vector<vector<string>> MakeRandomSamples(const SweepOptions& options)
+	{
+		mt19937_64 engine(options.sampleSeed);
+		vector<vector<string>> configurations(options.samples);
+		for (auto& configuration : configurations)
+		{
+			for (const auto& parameter : options.parameters)
+			{
+				if (!parameter.values.empty())
+				{
+					uniform_int_distribution<size_t> distribution(0, parameter.values.size() - 1);
+					configuration.push_back(parameter.values[distribution(engine)]);
+				}
+				else if (parameter.isIntegerRange)
+				{
+					uniform_int_distribution<long> distribution(lround(parameter.rangeMin), lround(parameter.rangeMax));
+					configuration.push_back(to_string(distribution(engine)));
+				}
+				else
+				{
+					uniform_real_distribution<double> distribution(parameter.rangeMin, parameter.rangeMax);
+					configuration.push_back(FormatRangeValue(parameter, distribution(engine)));
+				}
+			}
+		}
+		return configurations;
+	}
+
+
+	// the runner's --summary line is a list of key=value pairs
+	double GetSummaryValue(const char* line, const char* key)
+	{
+		const char* value = strstr(line, key);
+		return value ? strtod(value + strlen(key), nullptr) : 0.0;
+	}
+
+	SweepResult RunSimulation(const SweepOptions& options, const SweepRun& run)
+	{
+		char deltaTime[32];
+		snprintf(deltaTime, sizeof(deltaTime), "%.9g", options.deltaTime);
+		string command = "\"" + options.runnerPath + "\" --summary --until-game-over";
+		command += " --ticks " + to_string(options.ticks) + " --dt " + deltaTime + " --seed " + to_string(run.seed);
+		if (options.aiUpdateBudgetMicroseconds > 0)
+			command += " --set AI.UpdateBudgetMicroseconds=" + to_string(options.aiUpdateBudgetMicroseconds);
+		for (size_t i = 0; i < options.parameters.size(); ++i)
+			command += " --set " + options.parameters[i].name + "=" + run.values[i];
+
+		SweepResult result;
+		FILE* output = popen(command.c_str(), "r");
+		if (!output)
+			return result;
+
+		char line[256];
+		while (fgets(line, sizeof(line), output))
+		{
+			if (strncmp(line, "summary ", 8) == 0)
+			{
+				result.ticks = static_cast<int>(GetSummaryValue(line, "ticks="));
+				result.seconds = GetSummaryValue(line, "seconds=");
+				result.score = static_cast<int>(GetSummaryValue(line, "score="));
+				result.liveAliens = static_cast<int>(GetSummaryValue(line, "liveAliens="));
+				result.spawnedAliens = static_cast<int>(GetSummaryValue(line, "spawnedAliens="));
+				result.gameOverTick = static_cast<int>(GetSummaryValue(line, "gameOverTick="));
+				result.succeeded = true;
+			}
+		}
+		if (pclose(output) != 0)
+			result.succeeded = false;
+		return result;
+	}
+
+
+	void WriteCSV(ostream& stream, const SweepOptions& options, const vector<SweepRun>& runs, const vector<SweepResult>& results)
+	{
+		stream << "run,seed";
+		for (const auto& parameter : options.parameters)
+			stream << ',' << parameter.name;
+		stream << ",succeeded,ticks,score,liveAliens,spawnedAliens,cleared,timeToClear,secondsPerRun,msPerTick\n";
+
+		for (size_t i = 0; i < runs.size(); ++i)
+		{
+			const auto& run = runs[i];
+			const auto& result = results[i];
+			stream << i << ',' << run.seed;
+			for (const auto& value : run.values)
+				stream << ',' << value;
+			stream << ',' << (result.succeeded ? 1 : 0) << ',' << result.ticks << ',' << result.score << ',' << result.liveAliens << ',' << result.spawnedAliens;
+			stream << ',' << ((result.gameOverTick >= 0) ? 1 : 0) << ',';
+			if (result.gameOverTick >= 0)
+				stream << (result.gameOverTick + 1) * options.deltaTime;
+			stream << ',' << result.seconds << ',' << ((result.ticks > 0) ? 1000.0 * result.seconds / result.ticks : 0.0) << '\n';
+		}
+	}
+
+	void WriteJSON(ostream& stream, const SweepOptions& options, const vector<SweepRun>& runs, const vector<SweepResult>& results)
+	{
+		stream << "[\n";
+		for (size_t i = 0; i < runs.size(); ++i)
+		{
+			const auto& run = runs[i];
+			const auto& result = results[i];
+			stream << "\t{ \"run\": " << i << ", \"seed\": " << run.seed << ", \"parameters\": { ";
+			for (size_t p = 0; p < options.parameters.size(); ++p)
+				stream << (p ? ", " : "") << '"' << options.parameters[p].name << "\": \"" << run.values[p] << '"';
+			stream << " }, \"succeeded\": " << (result.succeeded ? "true" : "false") << ", \"ticks\": " << result.ticks;
+			stream << ", \"score\": " << result.score << ", \"liveAliens\": " << result.liveAliens << ", \"spawnedAliens\": " << result.spawnedAliens;
+			stream << ", \"timeToClear\": ";
+			if (result.gameOverTick >= 0)
+				stream << (result.gameOverTick + 1) * options.deltaTime;
+			else
+				stream << "null";
+			stream << ", \"secondsPerRun\": " << result.seconds << ", \"msPerTick\": " << ((result.ticks > 0) ? 1000.0 * result.seconds / result.ticks : 0.0);
+			stream << " }" << ((i + 1 < runs.size()) ? "," : "") << '\n';
+		}
+		stream << "]\n";
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	SweepOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	const auto configurations = (options.samples > 0) ? MakeRandomSamples(options) : MakeGrid(options);
+	vector<SweepRun> runs;
+	runs.reserve(configurations.size() * options.seeds);
+	for (const auto& configuration : configurations)
+	{
+		for (int seed = 1; seed <= options.seeds; ++seed)
+			runs.push_back(SweepRun { configuration, static_cast<uint64_t>(seed) });
+	}
+
+	printf("running %zu simulations of %zu configurations, %d at a time\n", runs.size(), configurations.size(), options.jobs);
+
+	// each worker takes the next run until there are none left
+	vector<SweepResult> results(runs.size());
+	atomic<size_t> nextRun { 0 };
+	atomic<size_t> completedRuns { 0 };
+	atomic<size_t> failedRuns { 0 };
+	vector<thread> workers;
+	for (int job = 0; job < options.jobs; ++job)
+	{
+		workers.emplace_back([&] ()
+		{
+			for (size_t runIndex = nextRun++; runIndex < runs.size(); runIndex = nextRun++)
+			{
+				results[runIndex] = RunSimulation(options, runs[runIndex]);
+				if (!results[runIndex].succeeded)
+					++failedRuns;
+				const size_t completed = ++completedRuns;
+				if ((completed % 10 == 0) || (completed == runs.size()))
+					printf("%zu/%zu\n", completed, runs.size());
+			}
+		});
+	}
+	for (auto& worker : workers)
+		worker.join();
+
+	if (failedRuns > 0)
+		printf("%zu simulations failed, check the parameter names with %s --set\n", failedRuns.load(), options.runnerPath.c_str());
+
+	if (options.csvFilename)
+	{
+		ofstream file(options.csvFilename);
+		WriteCSV(file, options, runs, results);
+	}
+	if (options.jsonFilename)
+	{
+		ofstream file(options.jsonFilename);
+		WriteJSON(file, options, runs, results);
+	}
+	if (!options.csvFilename && !options.jsonFilename)
+	{
+		WriteCSV(cout, options, runs, results);
+	}
+
+	return (failedRuns > 0) ? 1 : 0;
+}
@@ -0,0 +1,94 @@
+#include "timer_wheel.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace std;
+
+
+TimerWheel::TimerWheel(float tickDuration)
+	: m_tickDuration(tickDuration)
+{
+	assert(tickDuration > 0.0f);
+}
+
+
+void TimerWheel::Schedule(ObjectId objectId, uint32_t action, float dueTime)
+{
+	uint64_t dueTick = static_cast<uint64_t>(max(dueTime, 0.0f) / m_tickDuration);
+	Insert(TimedAction { objectId, action, max(dueTick, m_currentTick + 1) });
+	++m_pendingCount;
+}
+
+
+void TimerWheel::Insert(const TimedAction& timedAction)
+{
+	uint64_t delta = timedAction.dueTick - m_currentTick;
+	for (uint32_t level = 0; level < LevelCount; ++level)
+	{
+		if (delta < (1ull << (SlotBits * (level + 1))))
+		{
+			uint64_t slot = (timedAction.dueTick >> (SlotBits * level)) & (SlotsPerLevel - 1);
+			m_slots[level * SlotsPerLevel + slot].push_back(timedAction);
+			return;
+		}
+	}
+	m_overflow.push_back(timedAction);
+}
+
+
+void TimerWheel::Cascade(uint32_t level)
+{
+	// redistribute the slot of this level that has just come into range into the levels below
+	uint64_t slot = (m_currentTick >> (SlotBits * level)) & (SlotsPerLevel - 1);
+	auto& actions = m_slots[level * SlotsPerLevel + slot];
+	m_cascading.clear();
+	swap(m_cascading, actions);
+	for (const auto& timedAction : m_cascading)
+		Insert(timedAction);
+}
+
+
+void TimerWheel::Advance(float elapsedTime, vector<TimedAction>& dueActions)
+{
+	uint64_t targetTick = static_cast<uint64_t>(max(elapsedTime, 0.0f) / m_tickDuration);
+	while (m_currentTick < targetTick)
+	{
+		++m_currentTick;
+
+		// once the top level wraps, anything in the overflow list may now fit in the wheel
+		if ((m_currentTick & ((1ull << (SlotBits * LevelCount)) - 1)) == 0)
+		{
+			m_cascading.clear();
+			swap(m_cascading, m_overflow);
+			for (const auto& timedAction : m_cascading)
+				Insert(timedAction);
+		}
+
+		// cascade the higher levels first so that their actions can continue down into the lower levels
+		for (uint32_t level = LevelCount - 1; level > 0; --level)
+		{
+			if ((m_currentTick & ((1ull << (SlotBits * level)) - 1)) == 0)
+				Cascade(level);
+		}
+
+		auto& dueSlot = m_slots[m_currentTick & (SlotsPerLevel - 1)];
+		for (const auto& timedAction : dueSlot)
+		{
+			assert(timedAction.dueTick == m_currentTick);
+			dueActions.push_back(timedAction);
+		}
+		m_pendingCount -= dueSlot.size();
+		dueSlot.clear();
+	}
+}
+
+
+void TimerWheel::Reset(float elapsedTime)
+{
+	for (auto& slot : m_slots)
+		slot.clear();
+	m_overflow.clear();
+	m_pendingCount = 0;
+	m_currentTick = static_cast<uint64_t>(max(elapsedTime, 0.0f) / m_tickDuration);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "game.h"
+
+
+struct TimedAction
+{
+	ObjectId objectId;
+	uint32_t action; // interpreted by the system that scheduled it
+	uint64_t dueTick;
+};
+
+
+// A hierarchical timer wheel. Each level has 64 slots, each slot of a level spanning all 64 slots of the level below,
+// so scheduling is O(1) and advancing only touches the slots that come due, plus an occasional cascade of a higher
+// level slot down into the level below. Actions that are waiting cost nothing per frame.
+class TimerWheel
+{
+public:
+	static const uint32_t SlotBits = 6;
+	static const uint32_t SlotsPerLevel = 1 << SlotBits;
+	static const uint32_t LevelCount = 4;
+
+	explicit TimerWheel(float tickDuration = 0.01f);
+
+	// schedule an action at an absolute time, actions that are already due fire on the next tick
+	void Schedule(ObjectId objectId, uint32_t action, float dueTime);
+
+	// step the wheel forward to elapsedTime, appending every action that came due in order
+	void Advance(float elapsedTime, std::vector<TimedAction>& dueActions);
+
+	// drop every pending action and restart the wheel at elapsedTime
+	void Reset(float elapsedTime);
+
+	size_t GetPendingCount() const { return m_pendingCount; }
+
+private:
+	void Insert(const TimedAction& timedAction);
+	void Cascade(uint32_t level);
+
+	float m_tickDuration;
+	uint64_t m_currentTick { 0 };
+	size_t m_pendingCount { 0 };
+	std::array<std::vector<TimedAction>, SlotsPerLevel * LevelCount> m_slots;
+	std::vector<TimedAction> m_overflow; // actions beyond the range of the highest level
+	std::vector<TimedAction> m_cascading;
+};
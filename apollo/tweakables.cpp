@@ -1,5 +1,7 @@
 
 #include <algorithm>
+#include <cassert>
+#include <cstdlib>
 #include "tweakables.h"
 
 using namespace std;
@@ -114,6 +116,48 @@ void Tweakables::SetColor(const char* name, Color value)
 }
 
 
+bool Tweakables::SetFromString(const char* name, const char* value)
+{
+	auto* tweakable = GetTweakable(name);
+	if (!tweakable)
+		return false;
+
+	char* end = nullptr;
+	switch (tweakable->type)
+	{
+	case Tweakable::Type::Bool:
+		if ((strcmp(value, "true") == 0) || (strcmp(value, "1") == 0))
+			*tweakable->value.b = true;
+		else if ((strcmp(value, "false") == 0) || (strcmp(value, "0") == 0))
+			*tweakable->value.b = false;
+		else
+			return false;
+		return true;
+
+	case Tweakable::Type::Int:
+		{
+			const long parsedValue = strtol(value, &end, 10);
+			if ((end == value) || (*end != '\0'))
+				return false;
+			*tweakable->value.i = static_cast<int>(parsedValue);
+			return true;
+		}
+
+	case Tweakable::Type::Float:
+		{
+			const float parsedValue = strtof(value, &end);
+			if ((end == value) || (*end != '\0'))
+				return false;
+			*tweakable->value.f = parsedValue;
+			return true;
+		}
+
+	default:
+		return false;
+	}
+}
+
+
 
 const Tweakables::Tweakable* Tweakables::GetTweakable(const char* name) const
 {
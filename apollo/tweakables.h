@@ -1,6 +1,9 @@
 #pragma once
 
+#include <algorithm>
+#include <cassert>
 #include <cstdio>
+#include <cstring>
 #include <unordered_map>
 #include <vector>
 #include "math_helpers.h"
@@ -43,6 +46,9 @@ public:
 	Color GetColor(const char* name) const;
 	void SetColor(const char* name, Color value);
 
+	// parses and sets a bool, int or float tweakable, returns false if there is no such tweakable or the value doesn't parse
+	bool SetFromString(const char* name, const char* value);
+
 
 
 	struct Tweakable
@@ -5,97 +5,84 @@
 #include <tuple>
 #include <unordered_set>
 
+#include "camera.h"
 #include "physics.h"
 #include "player.h"
 #include "profiler.h"
+#include "spawn_placement.h"
 #include "math_helpers.h"
 #include "ai.h"
+#include "lifecycle_events.h"
+#include "tweakables.h"
+#include "world_chunks.h"
+#include "world_statistics.h"
 
 using namespace std;
 
-Vector2 minWorld { -640.0f, -360.0f };
-Vector2 maxWorld { 640.0f, 360.0f };
+// the size of the world is only read by InitWorld, a multiplier of 10 gives an arena 100 times the area of the window
+TWEAKABLE(int, worldSizeMultiplier, "World.SizeMultiplier", 1, 1, 10);
+TWEAKABLE(int, initialAlienCount, "World.InitialAlienCount", 30, 0, 50000);
+TWEAKABLE(float, activeChunkMargin, "World.ActiveChunkMargin", 512.0f, 0.0f, 4096.0f); // how far beyond the camera view the world is simulated
 
-GameObject player { GameObject::CreateGameObject<GameObjectType::Player>() };
-vector<GameObject> bullets;
-vector<GameObject> aliens;
-
-
-void CreatePlayerGameObject()
+void CreatePlayerGameObject(World& world)
 {
-	assert(player.objectId);
-	const auto& metaData = GetGameObjectMetaData(GameObjectType::Player);
+	// the player is the first object created, so it keeps the same id in every world
+	world.player = GameObject::CreateGameObject<GameObjectType::Player>(world);
+	const ObjectId objectId = world.player.objectId;
+	const auto& metaData = GameObjectTraits<GameObjectType::Player>::metaData;
 	Vector2 position { 50.0f, 20.0f };
 	Vector2 facing { 1.0f, 0.0f };
-	AddRigidBody(player.objectId, position, facing);
-	auto& collisionObject = AddCollisionObject(player.objectId, metaData.boundingBoxDimensions);
-	collisionObject.layer = CollisionLayer::Player;
-	collisionObject.layerMask = CollisionLayer::Alien;
+	AddRigidBody(world, objectId, position, facing);
+	auto& collisionObject = AddCollisionObject(world, objectId, metaData.GetBoundingBoxDimensions());
+	collisionObject.layer = metaData.collisionLayer;
+	collisionObject.layerMask = metaData.collisionLayerMask;
+	PublishLifecycleEvent(world, LifecycleEventType::Spawned, objectId, metaData.collisionLayer);
 }
 
 
-GameObject& GetGameObject(ObjectId objectId)
+const GameObject& GetGameObject(const World& world, ObjectId objectId)
 {
-	if (player.objectId == objectId)
-		return player;
+	if (world.player.objectId == objectId)
+		return world.player;
 	// we can use a binary search if we can guarantee that elements are never reordered.
+	const auto& aliens = world.aliens;
 	auto enemyIter = lower_bound(begin(aliens), end(aliens), objectId, [] (const auto& enemy, auto objectId) { return GetIndex(enemy.objectId) < GetIndex(objectId); });
 	if ((enemyIter != end(aliens)) && (enemyIter->objectId == objectId))
 		return *enemyIter;
+	const auto& bullets = world.bullets;
 	auto bulletIter = lower_bound(begin(bullets), end(bullets), objectId, [] (const auto& bullet, auto objectId) { return GetIndex(bullet.objectId) < GetIndex(objectId); });
 	assert((bulletIter != end(bullets)) && (bulletIter->objectId == objectId));
 	return *bulletIter;
 }
 
-
-tuple<Vector2, Vector2> findRandomPlaceToSpawnAlien()
+GameObject& GetGameObject(World& world, ObjectId objectId)
 {
-	Vector2 position { 0.0f, 0.0f };
-	bool haveGoodPosition = false;
-	do
-	{
-		position = GetRandomVectorInBox(minWorld + Vector2(40, 40), maxWorld - Vector2(40, 40));
-		haveGoodPosition = glm::distance(GetRigidBody(player.objectId).position, position) > 100.0f;
-		haveGoodPosition = haveGoodPosition &&
-			find_if(begin(collisionObjects), end(collisionObjects), [&position] (const CollisionObject& existingObject)
-			{
-				return glm::distance(existingObject.position, position) < 50.0f;
-			}) == end(collisionObjects);
-	} while (!haveGoodPosition);
-
-	Vector2 facing = GetRandomVectorOnCircle();
-
-	return make_tuple(position, facing);
+	return const_cast<GameObject&>(GetGameObject(static_cast<const World&>(world), objectId));
 }
 
-void CreateAlienPhysics(ObjectId objectId, const Vector2& position, const Vector2& facing)
-{
-	const auto& metaData = GetGameObjectMetaData(GetType(objectId));
-	AddRigidBody(objectId, position, facing);
-	auto& collisionObject = AddCollisionObject(objectId, metaData.boundingBoxDimensions);
-	collisionObject.layer = CollisionLayer::Alien;
-	collisionObject.layerMask = CollisionLayer::Player | CollisionLayer::PlayerBullet;
-}
 
+// the alien isn't created if there's no free position for it
 template <GameObjectType AlienType>
-GameObject& CreateAlien()
+void CreateAlien(World& world)
 {
-	aliens.push_back(GameObject::CreateGameObject<AlienType>());
-	GameObject& alien = aliens.back();
-
+	const auto& metaData = GameObjectTraits<AlienType>::metaData;
 	Vector2 position { 0.0f, 0.0f };
 	Vector2 facing { 0.0f, 0.0f };
-	tie(position, facing) = findRandomPlaceToSpawnAlien();
-	CreateAlienPhysics(alien.objectId, position, facing);
-
-	CreateAI(alien.objectId);
+	bool haveGoodPosition = false;
+	if constexpr (metaData.spawnLocation == SpawnLocation::AlongWall)
+		haveGoodPosition = FindSpawnPositionAlongWall(world, metaData.GetBoundingBoxDimensions(), position, facing);
+	else
+		haveGoodPosition = FindSpawnPositionInWorld(world, position, facing);
 
-	return alien;
+	if (haveGoodPosition)
+		SpawnAlien<AlienType>(world, position, facing);
 }
 
 
-float GetPositionAlongWallCoordFromPositionAndFacing(const Vector2& position, const Vector2& facing)
+float GetPositionAlongWallCoordFromPositionAndFacing(const World& world, const Vector2& position, const Vector2& facing)
 {
+	const Vector2& minWorld = world.minWorld;
+	const Vector2& maxWorld = world.maxWorld;
 	float wallWidth = maxWorld.x - minWorld.x;
 	float wallHeight = maxWorld.y - minWorld.y;
 	float totalWallLength = 2 * wallWidth + 2 * wallHeight;
@@ -133,8 +120,10 @@ float GetPositionAlongWallCoordFromPositionAndFacing(const Vector2& position, co
 	}
 }
 
-tuple<Vector2, Vector2> GetPositionAndFacingFromWallCoord(float p, const Vector2& collisionBoxDimensions)
+tuple<Vector2, Vector2> GetPositionAndFacingFromWallCoord(const World& world, float p, const Vector2& collisionBoxDimensions)
 {
+	const Vector2& minWorld = world.minWorld;
+	const Vector2& maxWorld = world.maxWorld;
 	float wallWidth = maxWorld.x - minWorld.x;
 	float wallHeight = maxWorld.y - minWorld.y;
 
@@ -175,193 +164,166 @@ tuple<Vector2, Vector2> GetPositionAndFacingFromWallCoord(float p, const Vector2
 	}
 }
 
-tuple<Vector2, Vector2> findRandomPlaceAlongWallToSpawnWallHugger(const Vector2& collisionBoxDimensions)
+template <GameObjectType... Types>
+constexpr int GetTotalSpawnWeight(GameObjectTypeList<Types...>)
 {
-	Vector2 position { 0.0f, 0.0f };
-	Vector2 facing = { 0.0f, 1.0f };
-
-	bool haveGoodPosition = false;
-	do
-	{
-		// treat the 4 walls as a single line (bottom, right, top, left)
-		// generate a random position along that line,
-		// then map it back to the original walls.
-		float wallWidth = maxWorld.x - minWorld.x;
-		float wallHeight = maxWorld.y - minWorld.y;
-		float wallLength = 2 * wallWidth + 2 * wallHeight;
-		float p = GetRandomFloat01() * wallLength;
-
-		tie(position, facing) = GetPositionAndFacingFromWallCoord(p, collisionBoxDimensions);
-
-		haveGoodPosition = glm::distance(GetRigidBody(player.objectId).position, position) > 100.0f;
-		haveGoodPosition = haveGoodPosition &&
-			find_if(begin(collisionObjects), end(collisionObjects), [&position] (const CollisionObject& existingObject)
-		{
-			return glm::distance(existingObject.position, position) < 50.0f;
-		}) == end(collisionObjects);
-	} while (!haveGoodPosition);
-
-	return make_tuple(position, facing);
+	return (GameObjectTraits<Types>::metaData.spawnWeight + ...);
 }
 
-template <>
-GameObject& CreateAlien<GameObjectType::AlienWallHugger>()
+void CreateRandomAlien(World& world)
 {
-	aliens.push_back(GameObject::CreateGameObject<GameObjectType::AlienWallHugger>());
-	GameObject& alien = aliens.back();
-
-	Vector2 position { 0.0f, 0.0f };
-	Vector2 facing { 0.0f, 0.0f };
-	const auto& metaData = GetGameObjectMetaData(GetType(alien.objectId));
-	Vector2 collisionBoundingBoxDimensions = metaData.boundingBoxDimensions;
-	tie(position, facing) = findRandomPlaceAlongWallToSpawnWallHugger(collisionBoundingBoxDimensions);
-	CreateAlienPhysics(alien.objectId, position, facing);
-	CreateAI(alien.objectId);
-
-	return alien;
+	// pick a type in proportion to the spawn weights in the traits
+	constexpr int totalSpawnWeight = GetTotalSpawnWeight(AIGameObjectTypes {});
+	static_assert(totalSpawnWeight > 0, "at least one alien type must have a spawn weight");
+	int random = min(static_cast<int>(GetRandomFloat01(world.random) * totalSpawnWeight), totalSpawnWeight - 1);
+	ForEachGameObjectType(AIGameObjectTypes {}, [&world, &random] <GameObjectType Type> () {
+		constexpr int spawnWeight = GameObjectTraits<Type>::metaData.spawnWeight;
+		if constexpr (spawnWeight > 0)
+		{
+			if ((random >= 0) && (random < spawnWeight))
+				CreateAlien<Type>(world);
+			random -= spawnWeight;
+		}
+	});
 }
 
-void CreateRandomAlien()
+
+void InitWorld(World& world)
 {
-	float random = GetRandomFloat01();
-	if (random < 0.2f)
-	{
-		CreateAlien<GameObjectType::AlienShy>();
-	}
-	else if (random < 0.5f)
-	{
-		CreateAlien<GameObjectType::AlienChase>();
-	}
-	else if (random < 0.8f)
-	{
-		CreateAlien<GameObjectType::AlienRandom>();
-	}
-	else if (random < 0.9f)
-	{
-		CreateAlien<GameObjectType::AlienMothership>();
-	}
-	else
-	{
-		CreateAlien<GameObjectType::AlienWallHugger>();
-	}
-}
+	InitWorldStatistics(world);
 
+	world.minWorld = static_cast<float>(worldSizeMultiplier) * Vector2 { -640.0f, -360.0f };
+	world.maxWorld = static_cast<float>(worldSizeMultiplier) * Vector2 { 640.0f, 360.0f };
+	world.initialMinWorld = world.minWorld;
+	world.initialMaxWorld = world.maxWorld;
+	InitWorldChunks(world, world.minWorld, world.maxWorld);
 
-void InitWorld()
-{
-	CreatePlayerGameObject();
+	CreatePlayerGameObject(world);
 
-	bullets.reserve(1000);
-	aliens.reserve(1000);
+	world.bullets.reserve(1000);
+	world.aliens.reserve(max(1000, initialAlienCount));
 
 	// create a bunch of aliens to shoot
-	const int numAliens = 30;
-	for (int i = 0; i < numAliens; ++i)
+	for (int i = 0; i < initialAlienCount; ++i)
 	{
-		CreateRandomAlien();
+		CreateRandomAlien(world);
 	}
+
+	DispatchLifecycleEvents(world);
 }
 
 
-void KillGameObject(ObjectId objectId)
+void KillGameObject(World& world, ObjectId objectId)
 {
 	// player is invincible
 	if (GetType(objectId) == GameObjectType::Player)
 		return;
 
-	GameObject& gameObject = GetGameObject(objectId);
+	GameObject& gameObject = GetGameObject(world, objectId);
 	if (!gameObject.isAlive)
 		return;
-	IncrementPlayerScoreForKilling(objectId);
+	IncrementPlayerScoreForKilling(world, objectId);
 	gameObject.isAlive = false;
 
-	auto& collisionObject = GetCollisionObject(objectId);
+	auto& collisionObject = GetCollisionObject(world, objectId);
+	PublishLifecycleEvent(world, LifecycleEventType::Killed, objectId, collisionObject.layer);
 	collisionObject.layer = CollisionLayer::PendingDestruction;
 	collisionObject.layerMask = CollisionLayer::None;
 }
 
 
 
-void UpdateWorld(const Time& time)
+void UpdateWorld(World& world, const Time& time)
 {
 	PROFILER_TIMER_FUNCTION();
 
-	static vector<pair<ObjectId, ObjectId>> collidingPairs;
-	static vector<ObjectId> collidingWithWorld;
+	// scratch space, one per thread as each thread may be stepping its own world
+	thread_local vector<pair<ObjectId, ObjectId>> collidingPairs;
+	thread_local vector<ObjectId> collidingWithWorld;
+
+	// only the chunks around the camera are simulated this frame
+	UpdateCamera(world.camera, GetRigidBody(world, world.player.objectId).position, world.initialMinWorld, world.initialMaxWorld);
+	UpdateActiveWorldChunks(world.chunks, GetCameraViewMin(world.camera) - Vector2 { activeChunkMargin, activeChunkMargin }, GetCameraViewMax(world.camera) + Vector2 { activeChunkMargin, activeChunkMargin });
 
-	UpdateRigidBodies(time);
+	UpdateRigidBodies(world, time);
+	InvalidateSpawnOccupancy(world);
 
-	EnsurePlayerIsInsideWorldBounds();
+	EnsurePlayerIsInsideWorldBounds(world);
 
-	UpdateCollision(time, collidingPairs, collidingWithWorld);
+	UpdateCollision(world, time, collidingPairs, collidingWithWorld);
 
 	// resolve objects that have collided against the world
 	for (const auto objectId : collidingWithWorld)
 	{
 		if ((GetType(objectId) != GameObjectType::Player) && (GetType(objectId) != GameObjectType::AlienWallHugger))
-			KillGameObject(objectId);
+			KillGameObject(world, objectId);
 	}
 
 	// resolve game object - game object collision pairs
-	for (const auto collidingPair : collidingPairs)
+	for (const auto& collidingPair : collidingPairs)
 	{
-		KillGameObject(collidingPair.first);
-		KillGameObject(collidingPair.second);
+		KillGameObject(world, collidingPair.first);
+		KillGameObject(world, collidingPair.second);
 	}
 
+	// let the other systems know about this frame's deaths and spawns before the AI runs
+	DispatchLifecycleEvents(world);
+
 	// update the AI
-	UpdateAI(time);
+	UpdateAI(world, time);
 }
 
 
-bool IsGameOver()
+bool IsGameOver(const World& world)
 {
-	return !any_of(begin(aliens), end(aliens), [] (const GameObject& alien) { return alien.isAlive; });
+	return GetLiveAlienCount(world) == 0;
 }
 
 
-GameObject CreateBullet(const Vector2& position, const Vector2& velocity, CollisionLayer collisionLayer, CollisionLayer collisionMask)
+GameObject CreateBullet(World& world, const Vector2& position, const Vector2& velocity, CollisionLayer collisionLayer, CollisionLayer collisionMask)
 {
-	bullets.push_back(GameObject::CreateGameObject<GameObjectType::Bullet>());
-	ObjectId objectId = bullets.back().objectId;
+	world.bullets.push_back(GameObject::CreateGameObject<GameObjectType::Bullet>(world));
+	ObjectId objectId = world.bullets.back().objectId;
 
-	auto& rigidBody = AddRigidBody(objectId, position, glm::normalize(velocity));
+	auto& rigidBody = AddRigidBody(world, objectId, position, glm::normalize(velocity));
 	rigidBody.velocity = velocity;
 	//printf("Fire Bullet %llu at %f, %f with velocity %f, %f\n", rigidBody.objectId, rigidBody.bulletPosition.x, rigidBody.bulletPosition.y, rigidBody.velocity.x, rigidBody.velocity.y);
 
-	auto& collisionObject = AddCollisionObject(objectId, Vector2 { 2.0f, 12.0f });
+	auto& collisionObject = AddCollisionObject(world, objectId, GameObjectTraits<GameObjectType::Bullet>::metaData.GetBoundingBoxDimensions());
 	collisionObject.layer = collisionLayer;
 	collisionObject.layerMask = collisionMask;
 
-	return bullets.back();
+	PublishLifecycleEvent(world, LifecycleEventType::Spawned, objectId, collisionLayer);
+
+	return world.bullets.back();
 }
 
-void FirePlayerBullet()
+void FirePlayerBullet(World& world)
 {
-	const auto& playerRB = GetRigidBody(player.objectId);
+	const auto& playerRB = GetRigidBody(world, world.player.objectId);
 	Vector2 fireOffset { 0.0f, 8.0f };
 	Vector4 bulletPosition4 = CalculateObjectTransform(playerRB.position, playerRB.facing) * Vector4(fireOffset, 0.0f, 1.0f);
 	Vector2 bulletPosition { bulletPosition4.x, bulletPosition4.y };
 	const float bulletSpeed = 1200.0f;
 	Vector2 bulletVelocity = bulletSpeed * playerRB.facing;
-	CreateBullet(bulletPosition, bulletVelocity, CollisionLayer::PlayerBullet, CollisionLayer::Alien);
+	CreateBullet(world, bulletPosition, bulletVelocity, CollisionLayer::PlayerBullet, CollisionLayer::Alien);
 }
 
 
-void CreateWall(const Vector2& startPosition, const Vector2& endPosition)
+void CreateWall(World& world, const Vector2& startPosition, const Vector2& endPosition)
 {
-	RigidBody& playerRB = GetRigidBody(player.objectId);
+	RigidBody& playerRB = GetRigidBody(world, world.player.objectId);
 	Vector2 playerPosition = playerRB.position;
 	if (IsSimilar(startPosition.y, endPosition.y))
 	{
 		// horizontal wall
 		if (startPosition.y < playerPosition.y)
 		{
-			minWorld.y = startPosition.y;
+			world.minWorld.y = startPosition.y;
 		}
 		else
 		{
-			maxWorld.y = startPosition.y;
+			world.maxWorld.y = startPosition.y;
 		}
 	}
 	else
@@ -370,33 +332,34 @@ void CreateWall(const Vector2& startPosition, const Vector2& endPosition)
 		// vertical wall
 		if (startPosition.x < playerPosition.x)
 		{
-			minWorld.x = startPosition.x;
+			world.minWorld.x = startPosition.x;
 		}
 		else
 		{
-			maxWorld.x = startPosition.x;
+			world.maxWorld.x = startPosition.x;
 		}
 	}
 }
 
 
-vector<ObjectId> GetAliensInCircle(const Vector2& center, float radius)
+vector<ObjectId> GetAliensInCircle(const World& world, const Vector2& center, float radius)
 {
 	vector<ObjectId> nearby;
-	nearby.reserve(aliens.size());
 
-	for (auto& alien : aliens)
+	// the world chunks only list live objects
+	ForEachObjectInWorldChunks(world.chunks, center - Vector2 { radius, radius }, center + Vector2 { radius, radius }, [&world, &nearby, &center, radius] (ObjectId objectId)
 	{
-		if (!alien.isAlive)
-			continue;
+		const auto type = GetType(objectId);
+		if ((type == GameObjectType::Player) || (type == GameObjectType::Bullet))
+			return;
 
-		const auto& rigidBody = GetRigidBody(alien.objectId);
+		const auto& rigidBody = GetRigidBody(world, objectId);
 		float distance = glm::distance(rigidBody.position, center);
 		if (distance <= radius)
 		{
-			nearby.push_back(alien.objectId);
+			nearby.push_back(objectId);
 		}
-	}
+	});
 
 	return nearby;
 }
@@ -5,40 +5,107 @@
 #include <vector>
 #include <cassert>
 
+#include "ai.h"
+#include "camera.h"
+#include "flow_field.h"
 #include "game.h"
 #include "math_helpers.h"
 #include "game_object.h"
+#include "lifecycle_events.h"
 #include "physics.h"
+#include "spawn_placement.h"
+#include "world_chunks.h"
+#include "world_statistics.h"
 
 
-extern Vector2 minWorld;
-extern Vector2 maxWorld;
+// Everything that one simulation owns. Nothing in the simulation is global, so any number of worlds can be stepped in
+// the same process, each one on its own thread if need be. The tweakables are shared configuration rather than state.
+struct World
+{
+	World() = default;
+	World(const World&) = delete;
+	World& operator=(const World&) = delete;
+
+	Vector2 minWorld { -640.0f, -360.0f };
+	Vector2 maxWorld { 640.0f, 360.0f };
+	// the camera stays inside the world as it was created, rather than following the walls in
+	Vector2 initialMinWorld { -640.0f, -360.0f };
+	Vector2 initialMaxWorld { 640.0f, 360.0f };
+
+	GameObject player;
+	std::vector<GameObject> bullets;
+	std::vector<GameObject> aliens;
+	uint32_t nextObjectIndex { 1 };
+
+	int playerScore { 0 };
+	float playerTimeOfLastShot { 0.0f };
+
+	RandomGenerator random;
 
-// World data
-extern GameObject player;
-extern std::vector<GameObject> bullets;
-extern std::vector<GameObject> aliens;
+	std::vector<RigidBody> rigidBodies;
+	std::vector<CollisionObject> collisionObjects;
+	WorldChunks chunks;
+	Camera camera;
 
-GameObject& GetGameObject(ObjectId objectId);
+	AIState ai;
+	FlowField flowField;
+	SpawnPlacement spawnPlacement;
 
-void InitWorld();
-void UpdateWorld(const Time& time);
-bool IsGameOver();
+	LifecycleEvents lifecycleEvents;
+	WorldStatistics statistics;
+};
 
-GameObject CreateBullet(const Vector2& position, const Vector2& velocity, CollisionLayer collisionLayer, CollisionLayer collisionMask);
-void FirePlayerBullet();
+GameObject& GetGameObject(World& world, ObjectId objectId);
+const GameObject& GetGameObject(const World& world, ObjectId objectId);
+
+void InitWorld(World& world);
+void UpdateWorld(World& world, const Time& time);
+bool IsGameOver(const World& world);
+
+GameObject CreateBullet(World& world, const Vector2& position, const Vector2& velocity, CollisionLayer collisionLayer, CollisionLayer collisionMask);
+void FirePlayerBullet(World& world);
 
 template <GameObjectType GameObjectTypeT>
-GameObject GameObject::CreateGameObject()
+GameObject GameObject::CreateGameObject(World& world)
 {
 	GameObject object;
-	object.objectId = GetNextObjectId(GameObjectTypeT);
+	object.objectId = GetNextObjectId(world, GameObjectTypeT);
 	return object;
 }
 
-void CreateWall(const Vector2& startPosition, const Vector2& endPosition);
+template <GameObjectType Type>
+void CreateAI(World& world, ObjectId objectId)
+{
+	using AIModel = typename GameObjectTraits<Type>::AIModel;
+	if constexpr (!std::is_void_v<AIModel>)
+		GetAIModels<AIModel>(world.ai).Add(world, objectId);
+}
+
+// creates an alien with the physics and AI described by its traits, and publishes its spawn
+template <GameObjectType AlienType>
+GameObject& SpawnAlien(World& world, const Vector2& position, const Vector2& facing)
+{
+	const auto& metaData = GameObjectTraits<AlienType>::metaData;
+	world.aliens.push_back(GameObject::CreateGameObject<AlienType>(world));
+	GameObject& alien = world.aliens.back();
+
+	AddRigidBody(world, alien.objectId, position, facing);
+	auto& collisionObject = AddCollisionObject(world, alien.objectId, metaData.GetBoundingBoxDimensions());
+	collisionObject.layer = metaData.collisionLayer;
+	collisionObject.layerMask = metaData.collisionLayerMask;
+
+	CreateAI<AlienType>(world, alien.objectId);
+	PublishLifecycleEvent(world, LifecycleEventType::Spawned, alien.objectId, metaData.collisionLayer);
+
+	return alien;
+}
+
+// spawns an alien of a type picked by the spawn weights in the traits, at a free position for that type if there is one
+void CreateRandomAlien(World& world);
+
+void CreateWall(World& world, const Vector2& startPosition, const Vector2& endPosition);
 
-std::vector<ObjectId> GetAliensInCircle(const Vector2& center, float radius);
+std::vector<ObjectId> GetAliensInCircle(const World& world, const Vector2& center, float radius);
 
-float GetPositionAlongWallCoordFromPositionAndFacing(const Vector2& position, const Vector2& facing);
-std::tuple<Vector2, Vector2> GetPositionAndFacingFromWallCoord(float p, const Vector2& collisionBoxDimensions);
+float GetPositionAlongWallCoordFromPositionAndFacing(const World& world, const Vector2& position, const Vector2& facing);
+std::tuple<Vector2, Vector2> GetPositionAndFacingFromWallCoord(const World& world, float p, const Vector2& collisionBoxDimensions);
@@ -0,0 +1,122 @@
+#include "world_chunks.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "lifecycle_events.h"
+#include "physics.h"
+#include "profiler.h"
+#include "world.h"
+
+using namespace std;
+
+
+namespace
+{
+	int GetWorldChunkX(const WorldChunks& worldChunks, float x)
+	{
+		return min(max(static_cast<int>(floor((x - worldChunks.origin.x) / worldChunks.chunkSize)), 0), worldChunks.width - 1);
+	}
+
+	int GetWorldChunkY(const WorldChunks& worldChunks, float y)
+	{
+		return min(max(static_cast<int>(floor((y - worldChunks.origin.y) / worldChunks.chunkSize)), 0), worldChunks.height - 1);
+	}
+
+	void OnWorldChunksLifecycleEvent(World& world, const LifecycleEvent& lifecycleEvent)
+	{
+		// the chunks only list live objects, they are added as their rigid body is created
+		if (lifecycleEvent.type == LifecycleEventType::Killed)
+			RemoveFromWorldChunk(world.chunks, lifecycleEvent.objectId, GetRigidBody(world, lifecycleEvent.objectId).chunkIndex);
+	}
+}
+
+
+void InitWorldChunks(World& world, const Vector2& worldMin, const Vector2& worldMax)
+{
+	auto& worldChunks = world.chunks;
+	worldChunks.origin = worldMin;
+	worldChunks.width = max(1, static_cast<int>(ceil((worldMax.x - worldMin.x) / worldChunks.chunkSize)));
+	worldChunks.height = max(1, static_cast<int>(ceil((worldMax.y - worldMin.y) / worldChunks.chunkSize)));
+	worldChunks.chunks.assign(worldChunks.width * worldChunks.height, WorldChunk {});
+
+	SubscribeToLifecycleEvents(world, OnWorldChunksLifecycleEvent);
+}
+
+
+uint32_t GetWorldChunkIndex(const WorldChunks& worldChunks, const Vector2& position)
+{
+	// objects beyond the edge of the grid, such as a bullet leaving the world, belong to the nearest chunk
+	assert(!worldChunks.chunks.empty());
+	return static_cast<uint32_t>(GetWorldChunkY(worldChunks, position.y) * worldChunks.width + GetWorldChunkX(worldChunks, position.x));
+}
+
+
+void AddToWorldChunk(WorldChunks& worldChunks, ObjectId objectId, uint32_t chunkIndex)
+{
+	assert(chunkIndex < worldChunks.chunks.size());
+	worldChunks.chunks[chunkIndex].objectIds.push_back(objectId);
+}
+
+
+void RemoveFromWorldChunk(WorldChunks& worldChunks, ObjectId objectId, uint32_t chunkIndex)
+{
+	assert(chunkIndex < worldChunks.chunks.size());
+	auto& objectIds = worldChunks.chunks[chunkIndex].objectIds;
+	auto objectIter = find(begin(objectIds), end(objectIds), objectId);
+	assert(objectIter != end(objectIds));
+	*objectIter = objectIds.back();
+	objectIds.pop_back();
+}
+
+
+void UpdateActiveWorldChunks(WorldChunks& worldChunks, const Vector2& activeMin, const Vector2& activeMax)
+{
+	PROFILER_TIMER_FUNCTION();
+
+	worldChunks.activeMinX = GetWorldChunkX(worldChunks, activeMin.x);
+	worldChunks.activeMinY = GetWorldChunkY(worldChunks, activeMin.y);
+	worldChunks.activeMaxX = GetWorldChunkX(worldChunks, activeMax.x);
+	worldChunks.activeMaxY = GetWorldChunkY(worldChunks, activeMax.y);
+
+	worldChunks.activeObjectIds.clear();
+	for (int y = worldChunks.activeMinY; y <= worldChunks.activeMaxY; ++y)
+	{
+		for (int x = worldChunks.activeMinX; x <= worldChunks.activeMaxX; ++x)
+		{
+			const auto& objectIds = worldChunks.chunks[y * worldChunks.width + x].objectIds;
+			worldChunks.activeObjectIds.insert(end(worldChunks.activeObjectIds), begin(objectIds), end(objectIds));
+		}
+	}
+}
+
+
+bool IsWorldChunkActive(const WorldChunks& worldChunks, int chunkX, int chunkY)
+{
+	return (chunkX >= worldChunks.activeMinX) && (chunkX <= worldChunks.activeMaxX) && (chunkY >= worldChunks.activeMinY) && (chunkY <= worldChunks.activeMaxY);
+}
+
+
+bool IsWorldChunkActive(const WorldChunks& worldChunks, uint32_t chunkIndex)
+{
+	return IsWorldChunkActive(worldChunks, static_cast<int>(chunkIndex) % worldChunks.width, static_cast<int>(chunkIndex) / worldChunks.width);
+}
+
+
+bool IsObjectInActiveWorldChunk(const World& world, ObjectId objectId)
+{
+	return IsWorldChunkActive(world.chunks, GetRigidBody(world, objectId).chunkIndex);
+}
+
+
+Vector2 GetActiveWorldChunksMin(const WorldChunks& worldChunks)
+{
+	return worldChunks.origin + worldChunks.chunkSize * Vector2 { worldChunks.activeMinX, worldChunks.activeMinY };
+}
+
+
+Vector2 GetActiveWorldChunksMax(const WorldChunks& worldChunks)
+{
+	return worldChunks.origin + worldChunks.chunkSize * Vector2 { worldChunks.activeMaxX + 1, worldChunks.activeMaxY + 1 };
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "game.h"
+#include "math_helpers.h"
+
+struct World;
+
+
+// The world is divided into a grid of square chunks, each listing the live game objects whose rigid body is inside it.
+// Only the chunks around the camera are active. Physics, collision, AI and rendering walk the active chunks instead of
+// every object, so the cost of a frame scales with the active area rather than the size of the world, and everything
+// outside of it is frozen until the camera comes back.
+struct WorldChunk
+{
+	std::vector<ObjectId> objectIds;
+};
+
+struct WorldChunks
+{
+	Vector2 origin { 0.0f, 0.0f };
+	float chunkSize { 512.0f };
+	int width { 0 };
+	int height { 0 };
+	std::vector<WorldChunk> chunks;
+
+	// the rectangle of active chunks, inclusive
+	int activeMinX { 0 };
+	int activeMinY { 0 };
+	int activeMaxX { -1 };
+	int activeMaxY { -1 };
+
+	// the objects that were in the active chunks at the start of the frame
+	std::vector<ObjectId> activeObjectIds;
+};
+
+// the world only ever shrinks, so the grid is laid over the initial world once
+void InitWorldChunks(World& world, const Vector2& worldMin, const Vector2& worldMax);
+
+uint32_t GetWorldChunkIndex(const WorldChunks& worldChunks, const Vector2& position);
+void AddToWorldChunk(WorldChunks& worldChunks, ObjectId objectId, uint32_t chunkIndex);
+void RemoveFromWorldChunk(WorldChunks& worldChunks, ObjectId objectId, uint32_t chunkIndex);
+
+// activate the chunks overlapping the rectangle and gather the objects in them
+void UpdateActiveWorldChunks(WorldChunks& worldChunks, const Vector2& activeMin, const Vector2& activeMax);
+
+bool IsWorldChunkActive(const WorldChunks& worldChunks, uint32_t chunkIndex);
+bool IsWorldChunkActive(const WorldChunks& worldChunks, int chunkX, int chunkY);
+bool IsObjectInActiveWorldChunk(const World& world, ObjectId objectId);
+
+// the world space rectangle covered by the active chunks
+Vector2 GetActiveWorldChunksMin(const WorldChunks& worldChunks);
+Vector2 GetActiveWorldChunksMax(const WorldChunks& worldChunks);
+
+// calls function(objectId) for every object in the chunks overlapping the rectangle
+template <typename Function>
+void ForEachObjectInWorldChunks(const WorldChunks& worldChunks, const Vector2& rectMin, const Vector2& rectMax, Function&& function)
+{
+	if (worldChunks.chunks.empty())
+		return;
+	const int minX = std::max(static_cast<int>(std::floor((rectMin.x - worldChunks.origin.x) / worldChunks.chunkSize)), 0);
+	const int minY = std::max(static_cast<int>(std::floor((rectMin.y - worldChunks.origin.y) / worldChunks.chunkSize)), 0);
+	const int maxX = std::min(static_cast<int>(std::floor((rectMax.x - worldChunks.origin.x) / worldChunks.chunkSize)), worldChunks.width - 1);
+	const int maxY = std::min(static_cast<int>(std::floor((rectMax.y - worldChunks.origin.y) / worldChunks.chunkSize)), worldChunks.height - 1);
+	for (int y = minY; y <= maxY; ++y)
+	{
+		for (int x = minX; x <= maxX; ++x)
+		{
+			for (const auto objectId : worldChunks.chunks[y * worldChunks.width + x].objectIds)
+				function(objectId);
+		}
+	}
+}
@@ -0,0 +1,69 @@
+#include "world_statistics.h"
+
+#include <bit>
+#include <cassert>
+
+#include "lifecycle_events.h"
+#include "world.h"
+
+using namespace std;
+
+
+namespace
+{
+	size_t GetCollisionLayerBit(CollisionLayer collisionLayer)
+	{
+		size_t bit = static_cast<size_t>(countr_zero(static_cast<uint32_t>(collisionLayer)));
+		assert(bit < CollisionLayerBitCount);
+		return bit;
+	}
+
+	bool IsAlien(GameObjectType type)
+	{
+		return (type != GameObjectType::Player) && (type != GameObjectType::Bullet);
+	}
+
+	void OnWorldStatisticsLifecycleEvent(World& world, const LifecycleEvent& lifecycleEvent)
+	{
+		auto& worldStatistics = world.statistics;
+		const auto type = GetType(lifecycleEvent.objectId);
+		auto& typeStatistics = worldStatistics.types[static_cast<size_t>(type)];
+		const int liveChange = (lifecycleEvent.type == LifecycleEventType::Spawned) ? 1 : -1;
+
+		if (lifecycleEvent.type == LifecycleEventType::Spawned)
+			++typeStatistics.spawned;
+		else
+			++typeStatistics.killed;
+		typeStatistics.live += liveChange;
+		assert(typeStatistics.live >= 0);
+
+		if (IsAlien(type))
+			worldStatistics.liveAliens += liveChange;
+		else if (type == GameObjectType::Bullet)
+			worldStatistics.liveBullets[GetCollisionLayerBit(lifecycleEvent.collisionLayer)] += liveChange;
+	}
+}
+
+
+void InitWorldStatistics(World& world)
+{
+	SubscribeToLifecycleEvents(world, OnWorldStatisticsLifecycleEvent);
+}
+
+
+const GameObjectTypeStatistics& GetGameObjectTypeStatistics(const World& world, GameObjectType type)
+{
+	return world.statistics.types[static_cast<size_t>(type)];
+}
+
+
+int GetLiveAlienCount(const World& world)
+{
+	return world.statistics.liveAliens;
+}
+
+
+int GetLiveBulletCount(const World& world, CollisionLayer collisionLayer)
+{
+	return world.statistics.liveBullets[GetCollisionLayerBit(collisionLayer)];
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include "game.h"
+#include "physics.h"
+
+struct World;
+
+
+// Population counts that are kept up to date from the lifecycle events rather than by scanning the game objects,
+// so gameplay can query them in constant time and the profiler overlay can show them every frame.
+struct GameObjectTypeStatistics
+{
+	int spawned { 0 };
+	int live { 0 };
+	int killed { 0 };
+};
+
+// bullets are counted by the bit of their collision layer: Player, PlayerBullet, Alien
+const size_t CollisionLayerBitCount = 3;
+
+struct WorldStatistics
+{
+	std::array<GameObjectTypeStatistics, static_cast<size_t>(GameObjectType::Count)> types;
+	std::array<int, CollisionLayerBitCount> liveBullets {};
+	int liveAliens { 0 };
+};
+
+// subscribes the statistics to the lifecycle events
+void InitWorldStatistics(World& world);
+
+const GameObjectTypeStatistics& GetGameObjectTypeStatistics(const World& world, GameObjectType type);
+int GetLiveAlienCount(const World& world);
+int GetLiveBulletCount(const World& world, CollisionLayer collisionLayer);